@@ -0,0 +1,394 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file benchmarks the steppers of Conway's Game of Life declared in
+ * game_of_life.h using Google Benchmark.
+ *
+ * Basic build instructions
+ *
+ * compile: make benchmark
+ * run it: ./benchmark
+ *      ./benchmark --benchmark_filter=Packed //to run only the packed steppers
+ *
+ * Board sizes go from 64x64 to 16384x16384 cells, the naive stepper stopping
+ * at 4096x4096. Random soups are measured at 10%, 30% and 50% density, and
+ * the R-pentomino and the Gosper glider gun are placed at the centre of an
+ * otherwise dead board.
+ *
+ * The BM_Engine benchmarks step every engine of engine.h through their
+ * common interface, after checking that each one reaches the same cells as
+ * the naive engine, and report an error instead of a time when it does not.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#include "engine.h"
+#include "game_of_life.h"
+#include "gpu_world.h"
+#include "hashlife.h"
+#include "sparse_world.h"
+
+#include <benchmark/benchmark.h>
+#include <fcntl.h>
+#include <iostream>
+#include <sstream>
+
+/// Seed of the random soups, fixed so every run measures the same boards
+const unsigned SOUP_SEED = 42;
+
+/// Initial patterns of the benchmarked boards
+enum class Pattern { soup, r_pentomino, gosper_gun };
+
+const std::vector<std::string> R_PENTOMINO{".oo", "oo.", ".o."};
+
+const std::vector<std::string> GOSPER_GUN{
+    "........................o...........",
+    "......................o.o...........",
+    "............oo......oo............oo",
+    "...........o...o....oo............oo",
+    "oo........o.....o...oo..............",
+    "oo........o...o.oo....o.o...........",
+    "..........o.....o.......o...........",
+    "...........o...o....................",
+    "............oo......................"};
+
+/// Sets a cell of either grid type
+void set_cell(Board &board, size_t i, size_t j) { board(i, j) = Cell::alive; }
+void set_cell(PackedBoard &board, size_t i, size_t j) {
+  board.set(i, j, Cell::alive);
+}
+
+/**
+ * Fills a board with an initial pattern.
+ *
+ * @param board Grid passed by reference, expected to be dead.
+ * @param pattern Pattern to be placed.
+ * @param density int with the percentage of living cells of a soup.
+ */
+template <typename Grid>
+void seed_board(Grid &board, Pattern pattern, int density) {
+  if (pattern == Pattern::soup) {
+    generates_board_random_state(board, density / 100.0, SOUP_SEED);
+    return;
+  }
+
+  const std::vector<std::string> &rows =
+      pattern == Pattern::r_pentomino ? R_PENTOMINO : GOSPER_GUN;
+  const size_t top = (board.height() - rows.size()) / 2;
+  const size_t left = (board.width() - rows[0].size()) / 2;
+  for (size_t i = 0; i < rows.size(); ++i) {
+    for (size_t j = 0; j < rows[i].size(); ++j) {
+      if (rows[i][j] == 'o')
+        set_cell(board, top + i, left + j);
+    }
+  }
+}
+
+/// Reports the cells updated by a benchmark as items per second
+void count_cell_updates(benchmark::State &state, size_t size) {
+  state.SetItemsProcessed(state.iterations() * int64_t(size) * int64_t(size));
+}
+
+/// Name of the fastest packed kernel supported by the CPU
+std::string fastest_packed_kernel() {
+  for (const PackedKernel &kernel : packed_kernels()) {
+    if (kernel.supported())
+      return kernel.name;
+  }
+  return "scalar";
+}
+
+/**
+ * Steps a World on a square board.
+ *
+ * Arguments: size of the board, density of the soup (0 for the pattern),
+ * number of threads. An empty kernel selects the fastest one.
+ */
+template <typename Grid>
+void BM_WorldStep(benchmark::State &state, Pattern pattern, Schedule schedule,
+                  std::string kernel) {
+  const size_t size = state.range(0);
+  if (kernel.empty())
+    kernel = fastest_packed_kernel();
+  if (!select_packed_kernel(kernel)) {
+    state.SkipWithError(("kernel " + kernel + " not supported").c_str());
+    return;
+  }
+
+  World<Grid> world(size, size, state.range(2), schedule);
+  seed_board(world.edit_board(), pattern, state.range(1));
+  for (auto _ : state) {
+    world.step();
+    benchmark::DoNotOptimize(world.board().row(0));
+  }
+  state.counters["population"] = world.population();
+  count_cell_updates(state, size);
+}
+
+/// Size and generations of the board compared with the naive engine
+const size_t CHECKED_SIZE = 256;
+const std::uint64_t CHECKED_GENERATIONS = 200;
+
+/// Gosper gun at the centre of a square board
+Board gun_board(size_t size) {
+  Board board(size, size);
+  seed_board(board, Pattern::gosper_gun, 0);
+  return board;
+}
+
+/// Cells of the checked board stepped by the naive engine, computed once
+const Board &reference_cells() {
+  static const Board cells = [] {
+    World<Board> reference(CHECKED_SIZE, CHECKED_SIZE);
+    reference.load(gun_board(CHECKED_SIZE));
+    reference.step(CHECKED_GENERATIONS);
+    return reference.board();
+  }();
+  return cells;
+}
+
+/**
+ * Steps an engine through the interface of engine.h from the Gosper gun at
+ * the centre of a square board.
+ *
+ * The engine is first checked against the naive one on a board whose
+ * gliders do not reach the edges within CHECKED_GENERATIONS, so the engines
+ * on a plane find the cells of the torus.
+ *
+ * Arguments: size of the board.
+ *
+ * @param create Function returning a new engine for a square size.
+ */
+template <typename Create>
+void BM_Engine(benchmark::State &state, Engine engine, Create create) {
+  const size_t size = state.range(0);
+  select_engine_kernel(engine);
+
+  auto checked = create(CHECKED_SIZE);
+  checked->load(gun_board(CHECKED_SIZE));
+  checked->step(CHECKED_GENERATIONS);
+  Board cells(CHECKED_SIZE, CHECKED_SIZE);
+  checked->read(cells);
+  if (!is_region_equal(cells, reference_cells(), 0, CHECKED_SIZE, 0,
+                       CHECKED_SIZE)) {
+    state.SkipWithError("the cells differ from the naive engine");
+    return;
+  }
+
+  auto universe = create(size);
+  universe->load(gun_board(size));
+  for (auto _ : state)
+    universe->step();
+  state.counters["population"] = universe->population();
+  count_cell_updates(state, size);
+}
+
+/// Original in-place update_board, allocating a new board on every call
+void BM_UpdateBoardInPlace(benchmark::State &state) {
+  const size_t size = state.range(0);
+  Board board = board_factory(size);
+  seed_board(board, Pattern::soup, state.range(1));
+  for (auto _ : state) {
+    update_board(board);
+    benchmark::DoNotOptimize(board.row(0));
+  }
+  count_cell_updates(state, size);
+}
+BENCHMARK(BM_UpdateBoardInPlace)
+    ->ArgsProduct({{64, 256, 1024, 4096}, {30}})
+    ->Unit(benchmark::kMillisecond);
+
+void BM_NeighbourPosition(benchmark::State &state) {
+  const size_t size = state.range(0);
+  const std::vector<int> offset{-1, 1};
+  std::vector<size_t> position{0, 0};
+  for (auto _ : state) {
+    position[0] = (position[0] + 1) % size;
+    benchmark::DoNotOptimize(neighbour_position(offset, position, size));
+  }
+}
+BENCHMARK(BM_NeighbourPosition)->Arg(64)->Arg(16384);
+
+/// Random initial board with exactly 30% of living cells, filled by threads
+template <typename Grid> void BM_InitialState(benchmark::State &state) {
+  const size_t size = state.range(0);
+  Grid board(size, size);
+  for (auto _ : state) {
+    // Every cell is drawn again, so the board needs no clearing.
+    generates_board_initial_state(board, size * size * 3 / 10, SOUP_SEED,
+                                  state.range(1));
+    benchmark::DoNotOptimize(board.row(0));
+  }
+  count_cell_updates(state, size);
+}
+BENCHMARK_TEMPLATE(BM_InitialState, Board)
+    ->ArgsProduct({{1024, 16384}, {1, 4}})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_InitialState, PackedBoard)
+    ->ArgsProduct({{1024, 32768}, {1, 4}})
+    ->Unit(benchmark::kMillisecond);
+
+/// Worst case of is_everybody_dead: a dead board is scanned to the end
+template <typename Grid> void BM_IsEverybodyDead(benchmark::State &state) {
+  const size_t size = state.range(0);
+  const Grid board(size, size);
+  for (auto _ : state)
+    benchmark::DoNotOptimize(is_everybody_dead(board));
+  count_cell_updates(state, size);
+}
+BENCHMARK_TEMPLATE(BM_IsEverybodyDead, Board)
+    ->RangeMultiplier(4)
+    ->Range(64, 16384);
+BENCHMARK_TEMPLATE(BM_IsEverybodyDead, PackedBoard)
+    ->RangeMultiplier(4)
+    ->Range(64, 16384);
+
+/// print_board into a discarded stream
+template <typename Grid> void BM_PrintBoard(benchmark::State &state) {
+  const size_t size = state.range(0);
+  Grid board(size, size);
+  seed_board(board, Pattern::soup, 30);
+
+  std::ostringstream sink;
+  std::streambuf *output = std::cout.rdbuf(sink.rdbuf());
+  for (auto _ : state) {
+    print_board(board);
+    sink.str("");
+  }
+  std::cout.rdbuf(output);
+  count_cell_updates(state, size);
+}
+BENCHMARK_TEMPLATE(BM_PrintBoard, Board)->Arg(64)->Arg(256);
+BENCHMARK_TEMPLATE(BM_PrintBoard, PackedBoard)->Arg(64)->Arg(256);
+
+/// Incremental TerminalRenderer frames of an evolving soup, sent to /dev/null
+template <typename Grid> void BM_RenderFrame(benchmark::State &state) {
+  const size_t size = state.range(0);
+  World<Grid> world(size, size);
+  seed_board(world.edit_board(), Pattern::soup, 30);
+
+  const int null_fd = open("/dev/null", O_WRONLY);
+  TerminalRenderer renderer(null_fd);
+  for (auto _ : state) {
+    state.PauseTiming();
+    world.step();
+    state.ResumeTiming();
+    renderer.render(world.board(), "status");
+  }
+  close(null_fd);
+  count_cell_updates(state, size);
+}
+BENCHMARK_TEMPLATE(BM_RenderFrame, Board)->Arg(64)->Arg(256);
+
+/// Registers the World benchmarks of every stepper, kernel and pattern
+void register_world_benchmarks() {
+  const std::vector<int64_t> all_sizes{64, 256, 1024, 4096, 16384};
+  const std::vector<int64_t> naive_sizes{64, 256, 1024, 4096};
+  const std::vector<int64_t> densities{10, 30, 50};
+  const std::vector<int64_t> threads{1};
+  const std::vector<std::pair<std::string, Pattern>> patterns{
+      {"RPentomino", Pattern::r_pentomino}, {"GosperGun", Pattern::gosper_gun}};
+
+  benchmark::RegisterBenchmark("BM_WorldStep/Naive/Soup",
+                               BM_WorldStep<Board>, Pattern::soup,
+                               Schedule::bands, "")
+      ->ArgsProduct({naive_sizes, densities, threads})
+      ->Unit(benchmark::kMillisecond);
+
+  for (const PackedKernel &kernel : packed_kernels()) {
+    if (!kernel.supported())
+      continue;
+    benchmark::RegisterBenchmark(
+        ("BM_WorldStep/Packed/" + std::string(kernel.name) + "/Soup").c_str(),
+        BM_WorldStep<PackedBoard>, Pattern::soup, Schedule::bands,
+        kernel.name)
+        ->ArgsProduct({all_sizes, densities, threads})
+        ->Unit(benchmark::kMillisecond);
+  }
+
+  for (const auto &pattern : patterns) {
+    benchmark::RegisterBenchmark(
+        ("BM_WorldStep/Naive/" + pattern.first).c_str(), BM_WorldStep<Board>,
+        pattern.second, Schedule::bands, "")
+        ->ArgsProduct({naive_sizes, {0}, threads})
+        ->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark(
+        ("BM_WorldStep/Packed/" + pattern.first).c_str(),
+        BM_WorldStep<PackedBoard>, pattern.second, Schedule::bands, "")
+        ->ArgsProduct({all_sizes, {0}, threads})
+        ->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark(
+        ("BM_WorldStep/PackedTiles/" + pattern.first).c_str(),
+        BM_WorldStep<PackedBoard>, pattern.second, Schedule::tiles, "")
+        ->ArgsProduct({all_sizes, {0}, threads})
+        ->Unit(benchmark::kMillisecond);
+  }
+
+  std::vector<int64_t> thread_counts{1, 2, 4};
+  if (std::thread::hardware_concurrency() > 4)
+    thread_counts.push_back(std::thread::hardware_concurrency());
+  benchmark::RegisterBenchmark("BM_WorldStep/PackedThreads/Soup",
+                               BM_WorldStep<PackedBoard>, Pattern::soup,
+                               Schedule::bands, "")
+      ->ArgsProduct({{4096, 16384}, {30}, thread_counts})
+      ->Unit(benchmark::kMillisecond);
+}
+
+/// Registers the BM_Engine benchmarks of every engine compiled in
+void register_engine_benchmarks() {
+  const std::vector<int64_t> sizes{1024, 4096};
+  const auto world = [](size_t threads) {
+    return [threads](size_t size) {
+      return std::unique_ptr<World<PackedBoard>>(
+          new World<PackedBoard>(size, size, threads));
+    };
+  };
+  const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+
+  const auto add = [&](Engine engine, auto create) {
+    benchmark::RegisterBenchmark(
+        ("BM_Engine/" + std::string(engine_string(engine))).c_str(),
+        BM_Engine<decltype(create)>, engine, create)
+        ->ArgsProduct({sizes})
+        ->Unit(benchmark::kMillisecond);
+  };
+  add(Engine::naive, [](size_t size) {
+    return std::unique_ptr<World<Board>>(new World<Board>(size, size));
+  });
+  add(Engine::packed, world(1));
+  add(Engine::simd, world(1));
+  add(Engine::parallel, world(cores));
+  add(Engine::hashlife,
+      [](size_t) { return std::unique_ptr<HashLife>(new HashLife); });
+  add(Engine::sparse,
+      [](size_t) { return std::unique_ptr<SparseWorld>(new SparseWorld); });
+  if (GPU_ENABLED)
+    add(Engine::gpu, [](size_t size) {
+      return std::unique_ptr<GpuWorld>(new GpuWorld(size, size));
+    });
+}
+
+int main(int argc, char **argv) {
+  register_world_benchmarks();
+  register_engine_benchmarks();
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+}
@@ -0,0 +1,112 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file implements the cycle detection declared in cycle_detector.h.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#include "cycle_detector.h"
+
+#include <cstring>
+
+/*
+    Implementations
+*/
+
+CycleDetector::CycleDetector(size_t max_period)
+    : history(std::max<size_t>(1, max_period)) {}
+
+size_t CycleDetector::push() {
+  // The shortest period is reported, as any multiple of it matches too.
+  size_t period = 0;
+  for (size_t p = std::min(history.size(), generations); p > 0; --p) {
+    const Entry &entry = history[(generations - p) % history.size()];
+    if (entry.hash == current_hash && entry.population == population)
+      period = p;
+  }
+  history[generations % history.size()] = {current_hash, population};
+  generations++;
+  return period;
+}
+
+template <typename Grid> void CycleDetector::reset_with(const Grid &board) {
+  generations = 0;
+  width = board.width();
+  current_hash = 0;
+  population = 0;
+  for (size_t i = 0; i < board.height(); ++i) {
+    for (size_t j = 0; j < board.width(); ++j) {
+      if (board.get(i, j) == Cell::alive) {
+        current_hash ^= key(i, j);
+        population++;
+      }
+    }
+  }
+  push();
+}
+
+void CycleDetector::reset(const Board &board) { reset_with(board); }
+
+void CycleDetector::reset(const PackedBoard &board) { reset_with(board); }
+
+size_t CycleDetector::update(const Board &previous, const Board &board) {
+  for (size_t i = 0; i < board.height(); ++i) {
+    const Cell *before = previous.row(i), *after = board.row(i);
+    if (std::memcmp(before, after, board.width() * sizeof(Cell)) == 0)
+      continue;
+    // Cells are compared 8 at a time, the rows of a settling board being
+    // mostly unchanged.
+    for (size_t first = 0; first < board.width(); first += 8) {
+      const size_t last = std::min(first + 8, board.width());
+      std::uint64_t cells_before = 0, cells_after = 0;
+      std::memcpy(&cells_before, before + first, last - first);
+      std::memcpy(&cells_after, after + first, last - first);
+      if (cells_before == cells_after)
+        continue;
+      for (size_t j = first; j < last; ++j) {
+        if (before[j] == after[j])
+          continue;
+        current_hash ^= key(i, j);
+        if (after[j] == Cell::alive)
+          population++;
+        else
+          population--;
+      }
+    }
+  }
+  return push();
+}
+
+size_t CycleDetector::update(const PackedBoard &previous,
+                             const PackedBoard &board) {
+  for (size_t i = 0; i < board.height(); ++i) {
+    const PackedBoard::Word *before = previous.row(i), *after = board.row(i);
+    for (size_t k = 0; k < board.words_per_row(); ++k) {
+      PackedBoard::Word changed = before[k] ^ after[k];
+      if (!changed)
+        continue;
+      population += __builtin_popcountll(after[k] & changed);
+      population -= __builtin_popcountll(before[k] & changed);
+      for (; changed; changed &= changed - 1)
+        current_hash ^=
+            key(i, k * PackedBoard::WORD_BITS + __builtin_ctzll(changed));
+    }
+  }
+  return push();
+}
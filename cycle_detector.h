@@ -0,0 +1,104 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file declares the detection of still lifes and oscillating boards,
+ * used to end a game that will not change anymore.
+ *
+ * Each board is identified by its Zobrist hash: the XOR of a random 64 bit
+ * key for every living cell. Stepping only flips the keys of the cells that
+ * changed, so the hash of a settled board costs a scan for the changed words
+ * and almost nothing else. The hashes of the last generations are kept in a
+ * ring, and a board whose hash and population match one of them repeats with
+ * their distance as period.
+ *
+ * @see https://en.wikipedia.org/wiki/Zobrist_hashing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#ifndef CYCLE_DETECTOR_H
+#define CYCLE_DETECTOR_H
+
+#include "game_of_life.h"
+
+/**
+ * Finds the period of a board stepped one generation at a time.
+ *
+ * Two different boards only share their hash and population by chance, with
+ * a probability of about 2^-64 per pair, so a match is taken as a repetition
+ * without comparing the cells.
+ */
+class CycleDetector {
+public:
+  /**
+   * @param max_period size_t with the longest period detected, 1 to only
+   * detect still lifes.
+   */
+  explicit CycleDetector(size_t max_period);
+
+  /**
+   * Starts over from a board, forgetting the previous generations.
+   *
+   * @param board Grid passed as const reference, hashed cell by cell.
+   */
+  void reset(const Board &board);
+  void reset(const PackedBoard &board);
+
+  /**
+   * Moves to the next generation, hashing only the cells that changed.
+   *
+   * @param previous Grid passed as const reference with the generation given
+   * to reset or to the last update.
+   * @param board Grid passed as const reference with the next generation.
+   * @return size_t with the period board repeats with, 1 for a still life, or
+   * 0 if it matches none of the last max_period generations.
+   */
+  size_t update(const Board &previous, const Board &board);
+  size_t update(const PackedBoard &previous, const PackedBoard &board);
+
+  /// Zobrist hash of the current generation
+  std::uint64_t hash() const { return current_hash; }
+
+private:
+  /// Hash and population of a generation
+  struct Entry {
+    std::uint64_t hash;
+    size_t population;
+  };
+
+  /// Zobrist key of cell j of row i
+  std::uint64_t key(size_t i, size_t j) const {
+    return counter_random(ZOBRIST_KEY, i * width + j);
+  }
+
+  /// Records the current generation, returning the period it repeats with
+  size_t push();
+
+  template <typename Grid> void reset_with(const Grid &board);
+
+  /// Seed of the keys, fixed so that hashes can be compared between runs
+  static const std::uint64_t ZOBRIST_KEY = 0x5A0B215Cull;
+
+  std::vector<Entry> history; ///< Ring of the last max_period generations
+  size_t generations = 0;     ///< Generations pushed since reset
+  size_t width = 0;
+  std::uint64_t current_hash = 0;
+  size_t population = 0;
+};
+
+#endif // CYCLE_DETECTOR_H
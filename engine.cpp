@@ -0,0 +1,74 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file implements the selection of the engines declared in engine.h.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#include "engine.h"
+#include "game_of_life.h"
+
+/*
+    Implementations
+*/
+
+/// Engines in the order of the Engine enumeration, with their names
+static const Engine ENGINES[] = {Engine::naive,    Engine::packed,
+                                 Engine::simd,     Engine::parallel,
+                                 Engine::hashlife, Engine::sparse,
+                                 Engine::gpu};
+static const char *const ENGINE_NAMES[] = {
+    "naive", "packed", "simd", "parallel", "hashlife", "sparse", "gpu"};
+
+bool parse_engine(const std::string &name, Engine &engine) {
+  for (size_t e = 0; e < sizeof(ENGINES) / sizeof(ENGINES[0]); ++e) {
+    if (name == ENGINE_NAMES[e]) {
+      engine = ENGINES[e];
+      return true;
+    }
+  }
+  return false;
+}
+
+const char *engine_string(Engine engine) {
+  return ENGINE_NAMES[static_cast<int>(engine)];
+}
+
+std::string engine_list() {
+  std::string list;
+  for (const char *name : ENGINE_NAMES)
+    list += (list.empty() ? "" : ", ") + std::string(name);
+  return list;
+}
+
+bool is_world_engine(Engine engine) {
+  return engine == Engine::naive || engine == Engine::packed ||
+         engine == Engine::simd || engine == Engine::parallel;
+}
+
+void select_engine_kernel(Engine engine) {
+  if (engine == Engine::packed) {
+    select_packed_kernel("scalar");
+  } else if (engine == Engine::simd || engine == Engine::parallel) {
+    for (const PackedKernel &kernel : packed_kernels()) {
+      if (select_packed_kernel(kernel.name))
+        break;
+    }
+  }
+}
@@ -0,0 +1,79 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file declares the engines stepping the game and their selection by
+ * name, as given to --engine.
+ *
+ * Every engine offers the same interface, called through templates so that
+ * the calls are resolved at compile time:
+ *  load(board) replaces the cells by those of a Board or PackedBoard, at
+ *     generation 0
+ *  read(board, top, left) copies the cells of the region at (top, left), of
+ *     the size of board; snapshots are saved from a PackedBoard read whole
+ *  step(generations) advances the cells by any number of generations
+ *  generation() and population() tell where the engine is
+ *
+ * The World of game_of_life.h steps the naive, packed, simd and parallel
+ * engines on a torus, HashLife and SparseWorld step theirs on an unbounded
+ * plane and GpuWorld keeps its torus on the device.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <string>
+
+/// Engines stepping the game
+enum class Engine {
+  naive,    ///< World<Board>, one byte per cell, the reference of the others
+  packed,   ///< World<PackedBoard> with the portable scalar kernel
+  simd,     ///< World<PackedBoard> with the fastest kernel of the CPU
+  parallel, ///< simd with a thread per core unless told otherwise
+  hashlife, ///< HashLife on an unbounded plane
+  sparse,   ///< SparseWorld on an unbounded plane
+  gpu       ///< GpuWorld on a CUDA device
+};
+
+/**
+ * Parses the name of an engine, such as simd.
+ *
+ * @param name const std::string with the name.
+ * @param engine Engine passed by reference, set when the name is valid.
+ * @return bool true if the name is the one of an engine.
+ */
+bool parse_engine(const std::string &name, Engine &engine);
+
+/// Name of an engine, as parsed by parse_engine
+const char *engine_string(Engine engine);
+
+/// Names of all the engines separated by commas, for the error messages
+std::string engine_list();
+
+/// Whether the engine steps a World, where boards are stored on the host
+bool is_world_engine(Engine engine);
+
+/**
+ * Selects the packed kernel of an engine stepping a World<PackedBoard>: the
+ * scalar one for packed and the fastest one supported for simd and parallel.
+ * Other engines leave the kernel alone.
+ */
+void select_engine_kernel(Engine engine);
+
+#endif // ENGINE_H
@@ -0,0 +1,139 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file implements the batch runner declared in ensemble.h.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#include "ensemble.h"
+#include "cycle_detector.h"
+
+#include <map>
+
+/*
+    Implementations
+*/
+
+static const char *outcome_name(Outcome outcome) {
+  switch (outcome) {
+  case Outcome::dead:
+    return "dead";
+  case Outcome::still:
+    return "still";
+  case Outcome::oscillator:
+    return "oscillator";
+  case Outcome::running:
+    break;
+  }
+  return "running";
+}
+
+/**
+ * Writes the results of an ensemble in the order of their seeds, whatever
+ * the order the workers finish them.
+ */
+class ResultWriter {
+public:
+  ResultWriter(std::ostream &csv, std::uint64_t first_seed)
+      : csv(csv), next_seed(first_seed) {
+    csv << "seed,generations,population,period,outcome\n";
+  }
+
+  void write(const EnsembleResult &result) {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.emplace(result.seed, result);
+    for (auto found = pending.find(next_seed); found != pending.end();
+         found = pending.find(++next_seed)) {
+      const EnsembleResult &ready = found->second;
+      csv << ready.seed << ',' << ready.generations << ',' << ready.population
+          << ',' << ready.period << ',' << outcome_name(ready.outcome)
+          << '\n';
+      pending.erase(found);
+    }
+    csv.flush();
+  }
+
+private:
+  std::ostream &csv;
+  std::uint64_t next_seed; ///< Seed of the next line to be written
+  std::map<std::uint64_t, EnsembleResult> pending; ///< Results written later
+  std::mutex mutex;
+};
+
+/**
+ * Plays a board of an ensemble to its end.
+ *
+ * @param world World reused between the boards of a worker.
+ * @param cycles CycleDetector reused between the boards of a worker.
+ */
+template <typename Grid>
+static EnsembleResult play_board(const EnsembleSettings &settings,
+                                 std::uint64_t seed, World<Grid> &world,
+                                 CycleDetector &cycles) {
+  // Every cell is drawn again, so the board of the previous seed needs no
+  // clearing.
+  if (settings.density > 0)
+    generates_board_random_state(world.edit_board(), settings.density, seed);
+  else
+    generates_board_initial_state(world.edit_board(), settings.living_cells,
+                                  seed);
+  cycles.reset(world.board());
+
+  EnsembleResult result;
+  result.seed = seed;
+  while (world.population() > 0 &&
+         result.generations < settings.max_generations) {
+    world.step();
+    result.generations++;
+    result.period = cycles.update(world.previous_board(), world.board());
+    if (result.period) {
+      result.generations -= result.period;
+      break;
+    }
+  }
+  result.population = world.population();
+  result.outcome = result.population == 0 ? Outcome::dead
+                   : result.period == 1   ? Outcome::still
+                   : result.period        ? Outcome::oscillator
+                                          : Outcome::running;
+  return result;
+}
+
+template <typename Grid>
+static void run_ensemble_with(const EnsembleSettings &settings,
+                              std::ostream &csv) {
+  ResultWriter writer(csv, settings.first_seed);
+  std::atomic<size_t> next_run{0};
+  ThreadPool pool(std::max<size_t>(1, std::min(settings.threads,
+                                               settings.runs)));
+  pool.run([&](size_t) {
+    World<Grid> world(settings.width, settings.height);
+    CycleDetector cycles(settings.max_period);
+    for (size_t run = next_run++; run < settings.runs; run = next_run++)
+      writer.write(
+          play_board(settings, settings.first_seed + run, world, cycles));
+  });
+}
+
+void run_ensemble(const EnsembleSettings &settings, std::ostream &csv) {
+  if (settings.packed)
+    run_ensemble_with<PackedBoard>(settings, csv);
+  else
+    run_ensemble_with<Board>(settings, csv);
+}
@@ -0,0 +1,76 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file declares the batch runner playing an ensemble of independent
+ * random boards, one for each seed of a range, to gather statistics.
+ *
+ * Every core runs its own boards to their end, reusing the same World and
+ * cycle detector from a board to the next, and the outcome of each board is
+ * streamed as a line of CSV, in the order of the seeds.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include "game_of_life.h"
+
+#include <ostream>
+
+/// Settings shared by the boards of an ensemble
+struct EnsembleSettings {
+  size_t width = 64;           ///< Number of columns of each board
+  size_t height = 64;          ///< Number of rows of each board
+  size_t living_cells = 800;   ///< Exact number of initial living cells
+  double density = 0;          ///< Probability of a living cell, or 0
+  std::uint64_t first_seed = 0; ///< Seed of the first board
+  size_t runs = 1;             ///< Number of boards, with consecutive seeds
+  size_t max_generations = 1000; ///< Generations after which a board stops
+  size_t max_period = 30;      ///< Longest period detected
+  size_t threads = 1;          ///< Number of boards played at once
+  bool packed = false;         ///< Whether to use PackedBoards
+};
+
+/// How a board of an ensemble ended
+enum class Outcome { dead, still, oscillator, running };
+
+/// Final state of a board of an ensemble
+struct EnsembleResult {
+  std::uint64_t seed = 0;   ///< Seed of the initial cells
+  size_t generations = 0;   ///< Generations played until the end
+  size_t population = 0;    ///< Living cells at the end
+  size_t period = 0;        ///< Period of the final board, 0 if not found
+  Outcome outcome = Outcome::running;
+};
+
+/**
+ * Plays the boards of an ensemble and writes their results as CSV.
+ *
+ * The first line holds the names of the columns: seed, generations,
+ * population, period and outcome (dead, still, oscillator or running if it
+ * reached max_generations). A board is still or oscillator from the first
+ * generation its cells repeat, so generations is when it stabilized.
+ *
+ * @param settings const EnsembleSettings of the boards.
+ * @param csv std::ostream receiving a line per board as soon as the boards
+ * of all the previous seeds are written.
+ */
+void run_ensemble(const EnsembleSettings &settings, std::ostream &csv);
+
+#endif // ENSEMBLE_H
@@ -0,0 +1,313 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file implements the export of frames declared in frame_export.h.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#include "frame_export.h"
+
+#include <array>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <limits>
+#include <stdexcept>
+#include <unistd.h>
+
+/*
+    Implementations
+*/
+
+typedef PackedBoard::Word Word;
+
+static const ExportFormat FORMATS[] = {ExportFormat::bits, ExportFormat::delta,
+                                       ExportFormat::pgm, ExportFormat::y4m};
+static const char *const FORMAT_NAMES[] = {"bits", "delta", "pgm", "y4m"};
+
+bool parse_export_format(const std::string &name, ExportFormat &format) {
+  for (size_t f = 0; f < sizeof(FORMATS) / sizeof(FORMATS[0]); ++f) {
+    if (name == FORMAT_NAMES[f]) {
+      format = FORMATS[f];
+      return true;
+    }
+  }
+  return false;
+}
+
+const char *export_format_string(ExportFormat format) {
+  return FORMAT_NAMES[static_cast<int>(format)];
+}
+
+/// Error of the exported file, with the description of errno
+static std::runtime_error export_error(const std::string &path,
+                                       const std::string &what) {
+  return std::runtime_error(path + ": " + what + ": " + std::strerror(errno));
+}
+
+/// Bytes of 0 or 255 for the eight cells of a byte of a row
+static const std::array<std::array<char, 8>, 256> CELL_BYTES = [] {
+  std::array<std::array<char, 8>, 256> bytes{};
+  for (size_t value = 0; value < 256; ++value)
+    for (size_t bit = 0; bit < 8; ++bit)
+      bytes[value][bit] = value >> bit & 1 ? '\xff' : '\0';
+  return bytes;
+}();
+
+/// Appends the raw bytes of a value to a buffer
+template <typename T> static void append(std::string &output, const T &value) {
+  output.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+/// Appends the cells of a board as a byte of 0 or 255 each, row by row
+static void append_luma(std::string &output, const PackedBoard &board) {
+  const size_t start = output.size();
+  output.resize(start + board.width() * board.height());
+  char *luma = &output[start];
+  for (size_t i = 0; i < board.height(); ++i) {
+    const Word *row = board.row(i);
+    for (size_t j = 0; j < board.width(); j += 8) {
+      const unsigned byte = row[j / 64] >> (j % 64) & 0xff;
+      const size_t count = std::min<size_t>(8, board.width() - j);
+      std::memcpy(luma, CELL_BYTES[byte].data(), count);
+      luma += count;
+    }
+  }
+}
+
+/// Packs a board into another one, reusing its words if it has the same size
+static void pack_into(const Board &board, PackedBoard &packed) {
+  if (packed.width() != board.width() || packed.height() != board.height())
+    packed = PackedBoard(board.width(), board.height());
+  for (size_t i = 0; i < board.height(); ++i) {
+    const Cell *cells = board.row(i);
+    Word *row = packed.row(i);
+    for (size_t k = 0; k < packed.words_per_row(); ++k) {
+      Word word = 0;
+      const size_t end = std::min<size_t>(64, board.width() - k * 64);
+      for (size_t b = 0; b < end; ++b)
+        word |= Word(cells[k * 64 + b] == Cell::alive) << b;
+      row[k] = word;
+    }
+  }
+}
+
+FrameExporter::FrameExporter(const std::string &path, ExportFormat format,
+                             double frames_per_second)
+    : path(path), format(format), frames_per_second(frames_per_second),
+      rule(selected_rule()) {
+  if (path == "-") {
+    fd = STDOUT_FILENO;
+  } else {
+    fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+      throw export_error(path, "cannot create the export");
+  }
+  for (Slot &slot : slots)
+    free_slots.push_back(&slot);
+  encoder = std::thread([this] { run(); });
+}
+
+FrameExporter::~FrameExporter() {
+  try {
+    finish();
+  } catch (const std::runtime_error &) {
+    // Only an explicit finish reports the errors, not the unwinding of one.
+  }
+}
+
+FrameExporter::Slot &FrameExporter::acquire() {
+  std::unique_lock<std::mutex> lock(mutex);
+  changed.wait(lock, [this] { return !free_slots.empty() || error; });
+  if (error)
+    std::rethrow_exception(error);
+  Slot *slot = free_slots.front();
+  free_slots.pop_front();
+  return *slot;
+}
+
+void FrameExporter::submit(Slot &slot) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    queued.push_back(&slot);
+  }
+  changed.notify_all();
+}
+
+void FrameExporter::write(const PackedBoard &board, std::uint64_t generation) {
+  PROFILE_SCOPE("export");
+  Slot &slot = acquire();
+  slot.board = board;
+  slot.generation = generation;
+  submit(slot);
+}
+
+void FrameExporter::write(const Board &board, std::uint64_t generation) {
+  PROFILE_SCOPE("export");
+  Slot &slot = acquire();
+  pack_into(board, slot.board);
+  slot.generation = generation;
+  submit(slot);
+}
+
+void FrameExporter::finish() {
+  if (!encoder.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    closing = true;
+  }
+  changed.notify_all();
+  encoder.join();
+  if (fd != STDOUT_FILENO && close(fd) != 0 && !error)
+    error = std::make_exception_ptr(
+        export_error(path, "cannot write the export"));
+  fd = -1;
+  if (error)
+    std::rethrow_exception(error);
+}
+
+void FrameExporter::run() {
+  while (true) {
+    Slot *slot;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      changed.wait(lock, [this] { return !queued.empty() || closing; });
+      if (queued.empty())
+        return;
+      slot = queued.front();
+      queued.pop_front();
+    }
+    try {
+      PROFILE_SCOPE("encode");
+      encode(*slot);
+      flush();
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex);
+      error = std::current_exception();
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      free_slots.push_back(slot);
+    }
+    changed.notify_all();
+    if (error)
+      return;
+  }
+}
+
+void FrameExporter::encode(const Slot &slot) {
+  const PackedBoard &board = slot.board;
+  const size_t words = board.words_per_row() * board.height();
+  const bool first = !started;
+  if (first) {
+    width = board.width();
+    height = board.height();
+    started = true;
+  } else if (board.width() != width || board.height() != height) {
+    throw std::runtime_error(path + ": the frames of an export must have the "
+                             "same size");
+  }
+  output.clear();
+
+  if (format == ExportFormat::pgm) {
+    output += "P5\n# generation " + std::to_string(slot.generation) + "\n" +
+              std::to_string(width) + " " + std::to_string(height) +
+              "\n255\n";
+    append_luma(output, board);
+    return;
+  }
+  if (format == ExportFormat::y4m) {
+    if (first)
+      output += "YUV4MPEG2 W" + std::to_string(width) + " H" +
+                std::to_string(height) + " F" +
+                std::to_string(std::lround(frames_per_second * 1000)) +
+                ":1000 Ip A1:1 Cmono\n";
+    output += "FRAME\n";
+    append_luma(output, board);
+    return;
+  }
+
+  if (first) {
+    StreamHeader header{};
+    std::memcpy(header.magic, STREAM_MAGIC, sizeof(header.magic));
+    header.version = STREAM_VERSION;
+    header.header_size = sizeof(StreamHeader);
+    header.width = width;
+    header.height = height;
+    header.birth = rule.birth;
+    header.survival = rule.survival;
+    header.words_per_row = board.words_per_row();
+    header.format = format == ExportFormat::bits ? 0 : 1;
+    append(output, header);
+    if (format == ExportFormat::delta)
+      previous.assign(words, 0);
+  }
+
+  StreamFrameHeader frame{slot.generation, 0};
+  const size_t frame_start = output.size();
+  append(output, frame);
+  const Word *cells = board.row(0);
+  if (format == ExportFormat::bits) {
+    output.append(reinterpret_cast<const char *>(cells), words * sizeof(Word));
+  } else {
+    // Runs of unchanged words, each followed by the changed words after it.
+    const size_t longest = std::numeric_limits<std::uint32_t>::max();
+    size_t k = 0;
+    while (k < words) {
+      const size_t zeros_start = k;
+      while (k < words && k - zeros_start < longest && cells[k] == previous[k])
+        ++k;
+      const size_t literals_start = k;
+      while (k < words && k - literals_start < longest &&
+             cells[k] != previous[k])
+        ++k;
+      append(output, std::uint32_t(literals_start - zeros_start));
+      append(output, std::uint32_t(k - literals_start));
+      const size_t start = output.size();
+      output.resize(start + (k - literals_start) * sizeof(Word));
+      char *literals = &output[start];
+      for (size_t l = literals_start; l < k; ++l, literals += sizeof(Word)) {
+        const Word changed = cells[l] ^ previous[l];
+        std::memcpy(literals, &changed, sizeof(Word));
+      }
+    }
+    std::memcpy(previous.data(), cells, words * sizeof(Word));
+  }
+  frame.size = output.size() - frame_start - sizeof(frame);
+  std::memcpy(&output[frame_start], &frame, sizeof(frame));
+}
+
+void FrameExporter::flush() {
+  const char *bytes = output.data();
+  size_t size = output.size();
+  while (size > 0) {
+    const ssize_t result = ::write(fd, bytes, size);
+    if (result < 0) {
+      if (errno == EINTR)
+        continue;
+      throw export_error(path, "cannot write the export");
+    }
+    bytes += result;
+    size -= result;
+  }
+  written_frames++;
+  written_bytes += output.size();
+}
@@ -0,0 +1,192 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file declares the export of the generations of a game as a stream of
+ * frames, to record a run for later analysis or to pipe it into a video
+ * encoder.
+ *
+ * The bits and delta formats start with a 64 byte StreamHeader; every frame
+ * is then a StreamFrameHeader followed by its payload. A bits frame holds the
+ * rows of a PackedBoard, words_per_row 64 bit words each, as the snapshots do.
+ * A delta frame holds the XOR of those words with the previous frame, the
+ * first one with a dead board, coded as runs: a 32 bit number of zero words,
+ * a 32 bit number of literal words and the literal words, repeated until the
+ * board is covered. A settled board then costs a few bytes per frame. Every
+ * number is in the byte order of the machine that wrote it.
+ *
+ * The pgm format is a sequence of binary PGM images and the y4m format a
+ * YUV4MPEG2 video with a single plane, a byte of 0 or 255 per cell, both read
+ * by ffmpeg from a pipe:
+ *
+ *   ./main -p -s 1024 -m 1000 --export - --export-format y4m | ffmpeg -i -
+ *       run.mp4
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#ifndef FRAME_EXPORT_H
+#define FRAME_EXPORT_H
+
+#include "game_of_life.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Encoding of the frames of an export
+enum class ExportFormat {
+  bits,  ///< Bit packed rows
+  delta, ///< Run coded XOR with the previous frame
+  pgm,   ///< Binary PGM images
+  y4m    ///< YUV4MPEG2 monochrome video
+};
+
+/**
+ * Parses the name of an export format: bits, delta, pgm or y4m.
+ *
+ * @param name const std::string with the name.
+ * @param format ExportFormat passed by reference, set when the name is valid.
+ * @return bool true if the name is the one of a format.
+ */
+bool parse_export_format(const std::string &name, ExportFormat &format);
+
+/// Name of an export format, as parsed by parse_export_format
+const char *export_format_string(ExportFormat format);
+
+/// First bytes of the streams of the bits and delta formats
+const char STREAM_MAGIC[8] = {'G', 'O', 'L', 'S', 'T', 'R', 'M', '\0'};
+const std::uint32_t STREAM_VERSION = 1; ///< Version of the stream format
+
+/// Header at the start of a stream
+struct StreamHeader {
+  char magic[8];              ///< STREAM_MAGIC
+  std::uint32_t version;      ///< STREAM_VERSION
+  std::uint32_t header_size;  ///< Offset of the first frame
+  std::uint64_t width;        ///< Number of columns of the board
+  std::uint64_t height;       ///< Number of rows of the board
+  std::uint16_t birth;        ///< Rule::birth of the game
+  std::uint16_t survival;     ///< Rule::survival of the game
+  std::uint32_t words_per_row; ///< Number of words of each row
+  std::uint32_t format;       ///< 0 for bits, 1 for delta
+  std::uint8_t reserved[20];  ///< Kept at zero
+};
+static_assert(sizeof(StreamHeader) == 64, "the header has a fixed size");
+
+/// Header of each frame of a stream
+struct StreamFrameHeader {
+  std::uint64_t generation; ///< Generation of the frame
+  std::uint64_t size;       ///< Bytes of the payload following the header
+};
+
+/**
+ * Writes frames to a file or to the standard output from a background
+ * thread.
+ *
+ * The boards are copied into a few buffers reused from frame to frame and
+ * encoded by the thread, so the game only pays for the copy. Unlike the
+ * frames drawn on the terminal none is dropped: when every buffer waits to
+ * be written, write blocks until one is free.
+ */
+class FrameExporter {
+public:
+  /**
+   * Opens the stream, writing its header with the first frame.
+   *
+   * @param path const std::string with the file receiving the frames, or -
+   * for the standard output.
+   * @param format ExportFormat of the frames.
+   * @param frames_per_second double with the frame rate of a y4m video.
+   * @throws std::runtime_error if the file cannot be created.
+   */
+  FrameExporter(const std::string &path, ExportFormat format,
+                double frames_per_second);
+  ~FrameExporter();
+
+  FrameExporter(const FrameExporter &) = delete;
+  FrameExporter &operator=(const FrameExporter &) = delete;
+
+  /**
+   * Queues a frame, all of the same size as the first one.
+   *
+   * @param board Grid passed as const reference, copied before returning.
+   * @param generation uint64_t with the generation of board.
+   * @throws std::runtime_error if a previous frame could not be written.
+   */
+  void write(const PackedBoard &board, std::uint64_t generation);
+  void write(const Board &board, std::uint64_t generation);
+
+  /**
+   * Waits for the frames queued and closes the stream.
+   *
+   * @throws std::runtime_error if a frame could not be written.
+   */
+  void finish();
+
+  /// Number of frames written, once finished
+  std::uint64_t frames() const { return written_frames; }
+  /// Number of bytes written, once finished
+  std::uint64_t bytes() const { return written_bytes; }
+
+private:
+  /// Frame waiting in a buffer
+  struct Slot {
+    PackedBoard board;
+    std::uint64_t generation = 0;
+  };
+
+  /// Buffers of the frames, enough for the encoder to keep up with bursts
+  static const size_t SLOTS = 3;
+
+  /// Takes a free buffer, waiting for one if needed
+  Slot &acquire();
+  /// Hands a filled buffer to the encoder
+  void submit(Slot &slot);
+  /// Loop of the encoding thread
+  void run();
+  /// Encodes a frame into the output buffer
+  void encode(const Slot &slot);
+  /// Writes the output buffer to the stream
+  void flush();
+
+  std::string path;
+  ExportFormat format;
+  double frames_per_second;
+  int fd = -1;
+  Rule rule;
+
+  Slot slots[SLOTS];
+  std::deque<Slot *> free_slots, queued;
+  std::mutex mutex;
+  std::condition_variable changed;
+  bool closing = false;
+  std::exception_ptr error;
+  std::thread encoder;
+
+  // Only touched by the encoding thread until it is joined
+  bool started = false;
+  size_t width = 0, height = 0;            ///< Size of the first frame
+  std::vector<PackedBoard::Word> previous; ///< Words of the last delta frame
+  std::string output;
+  std::uint64_t written_frames = 0, written_bytes = 0;
+};
+
+#endif // FRAME_EXPORT_H
@@ -0,0 +1,1257 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file implements the boards, the steppers and the renderer declared in
+ * game_of_life.h.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#include "game_of_life.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <utility>
+
+/*
+    Implementations
+*/
+
+Board::Board(size_t width, size_t height, size_t stride, Cell initial_value)
+    : columns(width), rows(height), row_stride(stride),
+      cells(stride * height, Cell::dead), data(cells.data()) {
+  for (size_t i = 0; i < rows; ++i)
+    std::fill(row(i), row(i) + columns, initial_value);
+}
+
+Board::Board(size_t width, size_t height, size_t stride,
+             std::shared_ptr<Cell> storage)
+    : columns(width), rows(height), row_stride(stride),
+      storage(std::move(storage)), data(this->storage.get()) {}
+
+Board::Board(const Board &other)
+    : columns(other.columns), rows(other.rows), row_stride(other.row_stride),
+      cells(other.data, other.data + other.row_stride * other.rows),
+      data(cells.data()) {}
+
+Board::Board(Board &&other) noexcept { *this = std::move(other); }
+
+Board &Board::operator=(Board &&other) noexcept {
+  columns = std::exchange(other.columns, 0);
+  rows = std::exchange(other.rows, 0);
+  row_stride = std::exchange(other.row_stride, 0);
+  cells = std::move(other.cells);
+  storage = std::move(other.storage);
+  data = std::exchange(other.data, nullptr);
+  return *this;
+}
+
+Board &Board::operator=(const Board &other) {
+  if (this == &other)
+    return *this;
+  // Grids keep their memory, and where its pages are, when a board is loaded.
+  if (columns == other.columns && rows == other.rows &&
+      row_stride == other.row_stride) {
+    std::copy(other.data, other.data + row_stride * rows, data);
+    return *this;
+  }
+  *this = Board(other);
+  return *this;
+}
+
+Board board_factory(size_t size, Cell initial_value) {
+  return board_factory(size, size, initial_value);
+}
+
+Board board_factory(size_t width, size_t height, Cell initial_value,
+                    bool padded) {
+  size_t stride = width;
+  if (padded) {
+    const size_t cells_per_line = CACHE_LINE_SIZE / sizeof(Cell);
+    stride = (width + cells_per_line - 1) / cells_per_line * cells_per_line;
+  }
+  return Board(width, height, stride, initial_value);
+}
+
+std::uint64_t random_seed() {
+  std::random_device dev;
+  return std::uint64_t(dev()) << 32 | dev();
+}
+
+/// Bits of the densities, which are multiples of 2^-DENSITY_BITS
+const unsigned DENSITY_BITS = 32;
+
+/**
+ * Draws the random cells of the word at index of a board.
+ *
+ * Each bit of threshold, from the lowest set one, combines a random word into
+ * the cells: OR-ing it turns the probability p of a living cell into
+ * (1 + p) / 2 and AND-ing it into p / 2, which ends at threshold /
+ * 2^DENSITY_BITS.
+ */
+static inline PackedBoard::Word keyed_random_cells(std::uint64_t key,
+                                                   std::uint64_t index,
+                                                   std::uint64_t threshold) {
+  if (threshold >> DENSITY_BITS)
+    return ~PackedBoard::Word(0);
+  PackedBoard::Word cells = 0;
+  for (unsigned bit = threshold ? __builtin_ctzll(threshold) : DENSITY_BITS;
+       bit < DENSITY_BITS; ++bit) {
+    const PackedBoard::Word random =
+        counter_random(key, index * DENSITY_BITS + bit);
+    cells = (threshold >> bit) & 1 ? cells | random : cells & random;
+  }
+  return cells;
+}
+
+/// Stores the 64 cells starting at column 64 * k of row i, returning how many
+/// of them are alive
+static size_t store_cells(Board &board, size_t i, size_t k,
+                          PackedBoard::Word cells) {
+  Cell *row = board.row(i) + k * PackedBoard::WORD_BITS;
+  const size_t count =
+      std::min(PackedBoard::WORD_BITS, board.width() - k * PackedBoard::WORD_BITS);
+  if (count < PackedBoard::WORD_BITS)
+    cells &= (PackedBoard::Word(1) << count) - 1;
+  for (size_t j = 0; j < count; ++j)
+    row[j] = (cells >> j) & 1 ? Cell::alive : Cell::dead;
+  return __builtin_popcountll(cells);
+}
+
+static size_t store_cells(PackedBoard &board, size_t i, size_t k,
+                          PackedBoard::Word cells) {
+  if (k + 1 == board.words_per_row())
+    cells &= board.last_word_mask();
+  board.row(i)[k] = cells;
+  return __builtin_popcountll(cells);
+}
+
+/**
+ * Fills a board with random cells, each alive with probability threshold /
+ * 2^DENSITY_BITS, splitting its rows between threads.
+ *
+ * @return size_t with the number of living cells of the board.
+ */
+template <typename Grid>
+static size_t fill_random_cells(Grid &board, std::uint64_t threshold,
+                                std::uint64_t seed, size_t threads) {
+  const std::uint64_t key = mix_bits(seed);
+  const size_t words_per_row =
+      (board.width() + PackedBoard::WORD_BITS - 1) / PackedBoard::WORD_BITS;
+  ThreadPool pool(std::max<size_t>(1, std::min(threads, board.height())));
+  std::vector<size_t> populations(pool.size());
+  pool.run([&](size_t thread) {
+    const size_t first_row = board.height() * thread / pool.size();
+    const size_t last_row = board.height() * (thread + 1) / pool.size();
+    size_t population = 0;
+    for (size_t i = first_row; i < last_row; ++i) {
+      for (size_t k = 0; k < words_per_row; ++k)
+        population += store_cells(
+            board, i, k,
+            keyed_random_cells(key, i * words_per_row + k, threshold));
+    }
+    populations[thread] = population;
+  });
+  size_t population = 0;
+  for (size_t count : populations)
+    population += count;
+  return population;
+}
+
+std::uint64_t random_density_threshold(double density) {
+  density = std::min(1.0, std::max(0.0, density));
+  return std::uint64_t(std::llround(std::ldexp(density, DENSITY_BITS)));
+}
+
+std::uint64_t random_count_threshold(size_t number_of_cells, size_t cells) {
+  // Only the 16 highest bits of the density are kept, which halves the random
+  // words per cell and misses the count by at most cells / 2^17.
+  const std::uint64_t rounding = std::uint64_t(1) << (DENSITY_BITS - 17);
+  return (random_density_threshold(
+              cells ? double(std::min(number_of_cells, cells)) / cells : 0.0) +
+          rounding) &
+         ~(2 * rounding - 1);
+}
+
+PackedBoard::Word random_cells(std::uint64_t seed, std::uint64_t index,
+                               std::uint64_t threshold) {
+  return keyed_random_cells(mix_bits(seed), index, threshold);
+}
+
+size_t random_cell(std::uint64_t seed, std::uint64_t draw, size_t cells) {
+  return (unsigned __int128)counter_random(mix_bits(~seed), draw) * cells >>
+         64;
+}
+
+static Cell cell_at(const Board &board, size_t i, size_t j) {
+  return board(i, j);
+}
+static Cell cell_at(const PackedBoard &board, size_t i, size_t j) {
+  return board.get(i, j);
+}
+static void set_cell(Board &board, size_t i, size_t j, Cell cell) {
+  board(i, j) = cell;
+}
+static void set_cell(PackedBoard &board, size_t i, size_t j, Cell cell) {
+  board.set(i, j, cell);
+}
+
+template <typename Grid>
+static void generate_exact_cells(Grid &board, size_t number_of_cells,
+                                 std::uint64_t seed, size_t threads) {
+  const size_t cells = board.width() * board.height();
+  number_of_cells = std::min(number_of_cells, cells);
+  size_t population = fill_random_cells(
+      board, random_count_threshold(number_of_cells, cells), seed, threads);
+
+  // The difference is about the square root of the count: it is fixed by
+  // flipping random cells of the wrong state, drawn from a second stream.
+  const Cell wrong = population < number_of_cells ? Cell::dead : Cell::alive;
+  const Cell right = wrong == Cell::dead ? Cell::alive : Cell::dead;
+  for (std::uint64_t draw = 0; population != number_of_cells; ++draw) {
+    const size_t cell = random_cell(seed, draw, cells);
+    const size_t i = cell / board.width(), j = cell % board.width();
+    if (cell_at(board, i, j) == wrong) {
+      set_cell(board, i, j, right);
+      if (right == Cell::alive)
+        population++;
+      else
+        population--;
+    }
+  }
+}
+
+void generates_board_initial_state(Board &board, size_t number_of_cells,
+                                   std::uint64_t seed, size_t threads) {
+  generate_exact_cells(board, number_of_cells, seed, threads);
+}
+
+void generates_board_initial_state(PackedBoard &board, size_t number_of_cells,
+                                   std::uint64_t seed, size_t threads) {
+  generate_exact_cells(board, number_of_cells, seed, threads);
+}
+
+void generates_board_random_state(Board &board, double density,
+                                  std::uint64_t seed, size_t threads) {
+  fill_random_cells(board, random_density_threshold(density), seed, threads);
+}
+
+void generates_board_random_state(PackedBoard &board, double density,
+                                  std::uint64_t seed, size_t threads) {
+  fill_random_cells(board, random_density_threshold(density), seed, threads);
+}
+
+void TerminalRenderer::move_cursor(size_t line, size_t column) {
+  frame += "\x1b[" + std::to_string(line + 1) + ';' +
+           std::to_string(column + 1) + 'H';
+}
+
+void TerminalRenderer::flush() {
+  size_t written = 0;
+  while (written < frame.size()) {
+    const ssize_t result =
+        write(fd, frame.data() + written, frame.size() - written);
+    if (result < 0) {
+      if (errno == EINTR)
+        continue;
+      return;
+    }
+    written += result;
+  }
+}
+
+/**
+ * Formats a whole board, moving the cursor to the top of a cleared screen
+ * first, and prints it with a single flush.
+ */
+template <typename Grid> static void print_grid(const Grid &board) {
+  std::string text = "\x1b[H\x1b[2J";
+  text.reserve(text.size() +
+               board.height() * (board.width() * ALIVE_SYMBOL.size() + 1));
+  for (size_t i = 0; i < board.height(); ++i) {
+    for (size_t j = 0; j < board.width(); ++j)
+      text += board.get(i, j) == Cell::alive ? ALIVE_SYMBOL : DEAD_SYMBOL;
+    text += '\n';
+  }
+  std::cout << text << std::flush;
+}
+
+void print_board(const Board &board) { print_grid(board); }
+
+std::pair<int, int> neighbour_position(const std::vector<int> &coord,
+                                       const std::vector<size_t> &positions,
+                                       size_t board_size) {
+
+  int new_coords[2];
+
+  for (int i = 0; i < 2; ++i) {
+    new_coords[i] = positions[i] + coord[i];
+    if (new_coords[i] < 0 || new_coords[i] >= board_size) {
+      new_coords[i] = new_coords[i] < 0 ? board_size - 1 : 0;
+    }
+  }
+
+  return std::make_pair(new_coords[0], new_coords[1]);
+}
+
+/// Code of no rule, returned for an invalid rulestring
+const std::uint32_t INVALID_RULE = ~std::uint32_t(0);
+
+/// Code instantiating the generic steppers, which read the rule at run time
+const std::uint32_t GENERIC_RULE = INVALID_RULE - 1;
+
+/**
+ * Parses a rulestring in B/S notation into a rule code at compile time.
+ *
+ * @return the code of the rule, or INVALID_RULE.
+ */
+static constexpr std::uint32_t rule_code(const char *text) {
+  std::uint32_t code = 0;
+  for (unsigned part = 0; part < 2; ++part) {
+    const char letter = part == 0 ? 'B' : 'S';
+    if (*text != letter && *text != letter - 'A' + 'a')
+      return INVALID_RULE;
+    for (++text; *text >= '0' && *text <= '8'; ++text)
+      code |= std::uint32_t(1) << (part * 9 + *text - '0');
+    if (part == 0 && *text++ != '/')
+      return INVALID_RULE;
+  }
+  return *text == '\0' ? code : INVALID_RULE;
+}
+
+static_assert(rule_code("B3/S23") == CONWAY_RULE.code(),
+              "CONWAY_RULE must be B3/S23");
+
+bool parse_rule(const std::string &rulestring, Rule &rule) {
+  const std::uint32_t code = rule_code(rulestring.c_str());
+  if (code == INVALID_RULE || code & 1)
+    return false;
+  rule = Rule{std::uint16_t(code & 0x1FF), std::uint16_t(code >> 9)};
+  return true;
+}
+
+std::string rule_string(const Rule &rule) {
+  std::string text = "B";
+  for (int n = 0; n < 9; ++n) {
+    if (rule.birth >> n & 1)
+      text += char('0' + n);
+  }
+  text += "/S";
+  for (int n = 0; n < 9; ++n) {
+    if (rule.survival >> n & 1)
+      text += char('0' + n);
+  }
+  return text;
+}
+
+/**
+ * Next generation of a 2x2 block of cells, indexed by the 4x4 cells around
+ * it. Bit 4 * c + r of the index holds the cell of row r and column c of the
+ * neighbourhood, so that each column is a nibble and moving two columns to
+ * the east is a shift by 8. Bit 2 * c + r of an entry holds the next state of
+ * the cell of row r + 1 and column c + 1.
+ *
+ * Plain arrays rather than std::array keep the evaluation of the tables at
+ * compile time several times faster.
+ */
+struct BlockTable {
+  std::uint8_t cells[1 << 16];
+};
+
+static constexpr BlockTable block_table(std::uint32_t code) {
+  // Both columns of the block follow from the three columns around them,
+  // so the cells are first found for every 3x4 neighbourhood.
+  std::uint8_t columns[1 << 12] = {};
+  for (std::uint32_t cells = 0; cells < (1 << 12); ++cells) {
+    for (unsigned row = 1; row < 3; ++row) {
+      const std::uint32_t around = 0x777u << (row - 1);
+      const std::uint32_t center = std::uint32_t(1) << (4 + row);
+      const unsigned neighbours = __builtin_popcount(cells & around & ~center);
+      const bool alive = cells & center;
+      columns[cells] |= (code >> (alive * 9 + neighbours) & 1) << (row - 1);
+    }
+  }
+  BlockTable table{};
+  for (std::uint32_t block = 0; block < (1 << 16); ++block)
+    table.cells[block] = columns[block & 0xFFF] | columns[block >> 4] << 2;
+  return table;
+}
+
+/// Block table of a rule known at compile time
+template <std::uint32_t RULE> struct CompiledBlockTable {
+  static constexpr BlockTable cells = block_table(RULE);
+};
+
+static Rule current_rule = CONWAY_RULE;
+static std::uint32_t generic_code = CONWAY_RULE.code();
+/// Block table of the generic steppers, built by select_rule when selected
+static BlockTable generic_table;
+
+/// Block table of a stepper, GENERIC_RULE getting generic_table
+template <std::uint32_t RULE> static const BlockTable &rule_block_table() {
+  if constexpr (RULE == GENERIC_RULE)
+    return generic_table;
+  else
+    return CompiledBlockTable<RULE>::cells;
+}
+
+const Rule &selected_rule() { return current_rule; }
+
+void update_board(Board &board) {
+  Board temp_board =
+      Board(board.width(), board.height(), board.stride(), Cell::dead);
+  const size_t width = board.width();
+  const size_t height = board.height();
+  uint count_neighbors;
+
+  for (size_t i = 0; i < height; ++i) {
+    const Cell *rows[3] = {board.row(i == 0 ? height - 1 : i - 1), board.row(i),
+                           board.row(i + 1 == height ? 0 : i + 1)};
+    Cell *next_row = temp_board.row(i);
+
+    for (size_t j = 0; j < width; ++j) {
+      const size_t columns[3] = {j == 0 ? width - 1 : j - 1, j,
+                                 j + 1 == width ? 0 : j + 1};
+      const Cell cell = rows[1][j];
+      count_neighbors = 0;
+      for (const auto &offset : NEIGHBOURHOOD) {
+        if (rows[offset.first + 1][columns[offset.second + 1]] == Cell::alive)
+          count_neighbors++;
+      }
+
+      if (cell == Cell::alive && count_neighbors < MIN_NEIGHBOURS) {
+        next_row[j] = Cell::dead;
+      } else if (cell == Cell::alive && count_neighbors >= MIN_NEIGHBOURS and
+                 count_neighbors <= MAX_NEIGHBOURS) {
+        next_row[j] = Cell::alive;
+      } else if (cell == Cell::alive && count_neighbors > MAX_NEIGHBOURS) {
+        next_row[j] = Cell::dead;
+      } else if (cell == Cell::dead && count_neighbors == MAX_NEIGHBOURS) {
+        next_row[j] = Cell::alive;
+      } else {
+        next_row[j] = Cell::dead;
+      }
+    }
+  }
+  board = std::move(temp_board);
+}
+
+size_t update_board(const Board &board, Board &next_board) {
+  return update_board(board, next_board, 0, board.height());
+}
+
+size_t update_board(const Board &board, Board &next_board, size_t first_row,
+                  size_t last_row) {
+  return update_board(board, next_board, first_row, last_row, 0,
+                      board.width());
+}
+
+/**
+ * Board stepper of a rule, GENERIC_RULE reading it from generic_table.
+ *
+ * The region is updated two rows and two columns at a time: the 4x4 cells
+ * around each block are gathered a column of four cells at a time and looked
+ * up in the block table. A region with an odd number of rows or columns ends
+ * with blocks only partly written.
+ */
+template <std::uint32_t RULE>
+static size_t update_board_with(const Board &board, Board &next_board,
+                                size_t first_row, size_t last_row,
+                                size_t first_column, size_t last_column) {
+  const BlockTable &table = rule_block_table<RULE>();
+  const size_t width = board.width();
+  const size_t height = board.height();
+  size_t population = 0;
+
+  for (size_t i = first_row; i < last_row; i += 2) {
+    const bool pair = i + 1 < last_row;
+    // Rows around the block, following the same toroidal rule as
+    // neighbour_position.
+    const Cell *rows[4] = {board.row(i == 0 ? height - 1 : i - 1), board.row(i),
+                           board.row((i + 1) % height),
+                           board.row((i + 2) % height)};
+    Cell *next_row = next_board.row(i);
+    Cell *next_pair = pair ? next_board.row(i + 1) : nullptr;
+    const unsigned written = pair ? 0xF : 0x5;
+
+    const auto column = [&rows](size_t j) {
+      return unsigned(rows[0][j]) | unsigned(rows[1][j]) << 1 |
+             unsigned(rows[2][j]) << 2 | unsigned(rows[3][j]) << 3;
+    };
+    const auto wrapped = [width](size_t j) {
+      return j < width ? j : j % width;
+    };
+
+    unsigned index =
+        column(first_column == 0 ? width - 1 : first_column - 1) |
+        column(first_column) << 4;
+    size_t j = first_column;
+    for (; j + 1 < last_column; j += 2) {
+      index |= column(j + 1) << 8 | column(wrapped(j + 2)) << 12;
+      const unsigned cells = table.cells[index];
+      next_row[j] = Cell(cells & 1);
+      next_row[j + 1] = Cell(cells >> 2 & 1);
+      if (pair) {
+        next_pair[j] = Cell(cells >> 1 & 1);
+        next_pair[j + 1] = Cell(cells >> 3 & 1);
+      }
+      population += __builtin_popcount(cells & written);
+      index >>= 8;
+    }
+    if (j < last_column) {
+      // The last column of the block is past the region, so is its east one.
+      const unsigned cells = table.cells[index | column(wrapped(j + 1)) << 8];
+      next_row[j] = Cell(cells & 1);
+      if (pair)
+        next_pair[j] = Cell(cells >> 1 & 1);
+      population += __builtin_popcount(cells & written & 0x3);
+    }
+  }
+  return population;
+}
+
+bool is_region_equal(const Board &board, const Board &other, size_t first_row,
+                     size_t last_row, size_t first_column,
+                     size_t last_column) {
+  for (size_t i = first_row; i < last_row; ++i) {
+    if (!std::equal(board.row(i) + first_column, board.row(i) + last_column,
+                    other.row(i) + first_column))
+      return false;
+  }
+  return true;
+}
+
+bool is_region_dead(const Board &board, size_t first_row, size_t last_row,
+                    size_t first_column, size_t last_column) {
+  const size_t width = board.width();
+  const size_t height = board.height();
+  const size_t left = first_column == 0 ? width - 1 : first_column - 1;
+  const size_t right = last_column == width ? 0 : last_column;
+  const auto alive = [](Cell cell) { return cell == Cell::alive; };
+
+  for (size_t n = 0; n < last_row - first_row + 2; ++n) {
+    const size_t i = (first_row + height - 1 + n) % height;
+    const Cell *row = board.row(i);
+    if (row[left] == Cell::alive || row[right] == Cell::alive ||
+        std::any_of(row + first_column, row + last_column, alive))
+      return false;
+  }
+  return true;
+}
+
+void clear_region(Board &board, size_t first_row, size_t last_row,
+                  size_t first_column, size_t last_column) {
+  for (size_t i = first_row; i < last_row; ++i)
+    std::fill(board.row(i) + first_column, board.row(i) + last_column,
+              Cell::dead);
+}
+
+bool is_everybody_dead(const Board &board) {
+  PROFILE_SCOPE("is_everybody_dead");
+  for (size_t i = 0; i < board.height(); ++i) {
+    if (std::any_of(board.row(i), board.row(i) + board.width(),
+                    [](Cell cell) { return cell == Cell::alive; }))
+      return false;
+  }
+  return true;
+}
+
+PackedBoard::PackedBoard(size_t width, size_t height)
+    : columns(width), rows(height),
+      row_words((width + WORD_BITS - 1) / WORD_BITS),
+      last_mask(width % WORD_BITS == 0
+                    ? ~Word(0)
+                    : (Word(1) << (width % WORD_BITS)) - 1),
+      words(row_words * height, 0), data(words.data()) {}
+
+PackedBoard::PackedBoard(size_t width, size_t height,
+                         std::shared_ptr<Word> storage)
+    : columns(width), rows(height),
+      row_words((width + WORD_BITS - 1) / WORD_BITS),
+      last_mask(width % WORD_BITS == 0
+                    ? ~Word(0)
+                    : (Word(1) << (width % WORD_BITS)) - 1),
+      storage(std::move(storage)), data(this->storage.get()) {}
+
+PackedBoard::PackedBoard(const PackedBoard &other)
+    : columns(other.columns), rows(other.rows), row_words(other.row_words),
+      last_mask(other.last_mask),
+      words(other.data, other.data + other.row_words * other.rows),
+      data(words.data()) {}
+
+PackedBoard::PackedBoard(PackedBoard &&other) noexcept {
+  *this = std::move(other);
+}
+
+PackedBoard &PackedBoard::operator=(PackedBoard &&other) noexcept {
+  columns = std::exchange(other.columns, 0);
+  rows = std::exchange(other.rows, 0);
+  row_words = std::exchange(other.row_words, 0);
+  last_mask = std::exchange(other.last_mask, 0);
+  words = std::move(other.words);
+  storage = std::move(other.storage);
+  data = std::exchange(other.data, nullptr);
+  return *this;
+}
+
+PackedBoard &PackedBoard::operator=(const PackedBoard &other) {
+  if (this == &other)
+    return *this;
+  // Frames copied every generation reuse their words instead of reallocating,
+  // and grids keep their memory, and where its pages are, when loaded.
+  if (columns == other.columns && rows == other.rows) {
+    std::copy(other.data, other.data + row_words * rows, data);
+    return *this;
+  }
+  *this = PackedBoard(other);
+  return *this;
+}
+
+PackedBoard pack_board(const Board &board) {
+  PackedBoard packed(board.width(), board.height());
+  for (size_t i = 0; i < board.height(); ++i) {
+    for (size_t j = 0; j < board.width(); ++j)
+      packed.set(i, j, board(i, j));
+  }
+  return packed;
+}
+
+Board unpack_board(const PackedBoard &board) {
+  Board unpacked(board.width(), board.height());
+  for (size_t i = 0; i < board.height(); ++i) {
+    for (size_t j = 0; j < board.width(); ++j)
+      unpacked(i, j) = board.get(i, j);
+  }
+  return unpacked;
+}
+
+template <>
+Board map_grid<Board>(size_t width, size_t height, bool huge_pages,
+                      PageKind &pages) {
+  const GridMemory memory =
+      map_grid_memory(width * height * sizeof(Cell), huge_pages);
+  pages = memory.pages;
+  return Board(width, height, width,
+               std::shared_ptr<Cell>(memory.block,
+                                     static_cast<Cell *>(memory.block.get())));
+}
+
+template <>
+PackedBoard map_grid<PackedBoard>(size_t width, size_t height, bool huge_pages,
+                                  PageKind &pages) {
+  typedef PackedBoard::Word Word;
+  const size_t row_words =
+      (width + PackedBoard::WORD_BITS - 1) / PackedBoard::WORD_BITS;
+  const GridMemory memory =
+      map_grid_memory(row_words * height * sizeof(Word), huge_pages);
+  pages = memory.pages;
+  return PackedBoard(
+      width, height,
+      std::shared_ptr<Word>(memory.block,
+                            static_cast<Word *>(memory.block.get())));
+}
+
+void print_board(const PackedBoard &board) { print_grid(board); }
+
+/**
+ * Shifts the words of a packed row so that each bit holds its west (column
+ * - 1) or east (column + 1) neighbour, wrapping around the row.
+ *
+ * @param row const pointer to the first word of the row.
+ * @param k size_t with the index of the word to be shifted.
+ * @param board PackedBoard the row belongs to.
+ * @param west Word receiving the west neighbours of word k.
+ * @param east Word receiving the east neighbours of word k.
+ */
+static inline void shifted_words(const PackedBoard::Word *row, size_t k,
+                                 const PackedBoard &board,
+                                 PackedBoard::Word &west,
+                                 PackedBoard::Word &east) {
+  typedef PackedBoard::Word Word;
+  const size_t last = board.words_per_row() - 1;
+  const size_t last_bit = (board.width() - 1) % PackedBoard::WORD_BITS;
+  const Word word = row[k];
+
+  const Word carry_in = k == 0 ? (row[last] >> last_bit) & 1 : row[k - 1] >> 63;
+  west = (word << 1) | carry_in;
+  if (k == last)
+    east = (word >> 1) | ((row[0] & 1) << last_bit);
+  else
+    east = (word >> 1) | (row[k + 1] << 63);
+}
+
+// Vectors of Words are only passed between functions inlined into the kernel
+// enabling the instruction set, so the ABI notes about them are irrelevant.
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+/**
+ * Cells of a group having N living neighbours, kept alive if the rule says so.
+ *
+ * @param rule std::uint32_t with the code of the rule, a constant once inlined
+ * into a compiled stepper.
+ * @param cell W with the current cells.
+ * @param ones,twos,fours,eights W with the bits of the number of neighbours.
+ */
+template <unsigned N, typename W>
+static inline __attribute__((always_inline)) W
+rule_term(std::uint32_t rule, W cell, W ones, W twos, W fours, W eights) {
+  const W count = (N & 1 ? ones : ~ones) & (N & 2 ? twos : ~twos) &
+                  (N & 4 ? fours : ~fours) & (N & 8 ? eights : ~eights);
+  const bool birth = rule >> N & 1;
+  const bool survival = rule >> (9 + N) & 1;
+  if (birth && survival)
+    return count;
+  if (birth)
+    return count & ~cell;
+  if (survival)
+    return count & cell;
+  return count & ~count;
+}
+
+/// OR of the rule_term of every number of neighbours from 0 to 8
+template <typename W, unsigned... N>
+static inline __attribute__((always_inline)) W
+apply_rule(std::uint32_t rule, W cell, W ones, W twos, W fours, W eights,
+           std::integer_sequence<unsigned, N...>) {
+  return (rule_term<N>(rule, cell, ones, twos, fours, eights) | ...);
+}
+
+/**
+ * Applies the rules of the game to a group of cells given their neighbours.
+ *
+ * Works on a single Word as well as on a vector of Words, with the eight
+ * neighbours summed by bitwise full adders: the rows above and below go
+ * through full adders and the row itself through a half adder, each giving
+ * the (ones, twos) bits of a partial sum.
+ *
+ * @tparam RULE std::uint32_t with the code of the rule, or GENERIC_RULE.
+ * @return the cells of the next generation.
+ */
+template <std::uint32_t RULE, typename W>
+static inline __attribute__((always_inline)) W
+next_cells(W above_w, W above_c, W above_e, W row_w, W row_c, W row_e,
+           W below_w, W below_c, W below_e) {
+  const W above_ones = above_w ^ above_c ^ above_e;
+  const W above_twos = (above_w & above_c) | (above_e & (above_w ^ above_c));
+  const W below_ones = below_w ^ below_c ^ below_e;
+  const W below_twos = (below_w & below_c) | (below_e & (below_w ^ below_c));
+  const W row_ones = row_w ^ row_e;
+  const W row_twos = row_w & row_e;
+
+  const W ones = above_ones ^ below_ones ^ row_ones;
+  const W ones_carry =
+      (above_ones & below_ones) | (row_ones & (above_ones ^ below_ones));
+
+  if constexpr (RULE == CONWAY_RULE.code()) {
+    // A cell has two or three neighbours when exactly one of the four twos
+    // bits is set, and three when the ones bit is also set.
+    const W twos_low = above_twos ^ below_twos;
+    const W twos_high = row_twos ^ ones_carry;
+    const W single_two = (twos_low ^ twos_high) & ~(above_twos & below_twos) &
+                         ~(row_twos & ones_carry);
+
+    return single_two & (ones | row_c);
+  } else {
+    // The four twos bits summed into the twos, fours and eights bits.
+    const W twos_partial = above_twos ^ below_twos ^ row_twos;
+    const W fours_partial =
+        (above_twos & below_twos) | (row_twos & (above_twos ^ below_twos));
+    const W twos = twos_partial ^ ones_carry;
+    const W twos_carry = twos_partial & ones_carry;
+    const W fours = fours_partial ^ twos_carry;
+    const W eights = fours_partial & twos_carry;
+
+    return apply_rule(RULE == GENERIC_RULE ? generic_code : RULE, row_c, ones,
+                      twos, fours, eights,
+                      std::make_integer_sequence<unsigned, 9>());
+  }
+}
+
+/// Loads a V from possibly unaligned words
+template <typename V>
+static inline __attribute__((always_inline)) V
+load_words(const PackedBoard::Word *words) {
+  V vector;
+  std::memcpy(&vector, words, sizeof(V));
+  return vector;
+}
+
+/// West neighbours of the words starting at words, which is not a row edge
+template <typename V>
+static inline __attribute__((always_inline)) V
+west_words(const PackedBoard::Word *words) {
+  return (load_words<V>(words) << 1) | (load_words<V>(words - 1) >> 63);
+}
+
+/// East neighbours of the words starting at words, which is not a row edge
+template <typename V>
+static inline __attribute__((always_inline)) V
+east_words(const PackedBoard::Word *words) {
+  return (load_words<V>(words) >> 1) | (load_words<V>(words + 1) << 63);
+}
+
+/**
+ * Updates the interior words of a row, LANES words at a time.
+ *
+ * @tparam RULE std::uint32_t with the code of the rule, or GENERIC_RULE.
+ * @tparam V Word or vector of Words processed at once.
+ * @tparam LANES size_t with the number of Words in V.
+ */
+template <std::uint32_t RULE, typename V, size_t LANES>
+static inline __attribute__((always_inline)) void
+packed_row_kernel(const PackedBoard::Word *above, const PackedBoard::Word *row,
+                  const PackedBoard::Word *below, PackedBoard::Word *next,
+                  size_t begin, size_t end) {
+  typedef PackedBoard::Word Word;
+  size_t k = begin;
+
+  for (; k + LANES <= end; k += LANES) {
+    const V cells = next_cells<RULE>(
+        west_words<V>(above + k), load_words<V>(above + k),
+        east_words<V>(above + k), west_words<V>(row + k),
+        load_words<V>(row + k), east_words<V>(row + k),
+        west_words<V>(below + k), load_words<V>(below + k),
+        east_words<V>(below + k));
+    std::memcpy(next + k, &cells, sizeof(V));
+  }
+  for (; k < end; ++k) {
+    next[k] = next_cells<RULE>(
+        west_words<Word>(above + k), above[k], east_words<Word>(above + k),
+        west_words<Word>(row + k), row[k], east_words<Word>(row + k),
+        west_words<Word>(below + k), below[k], east_words<Word>(below + k));
+  }
+}
+
+static bool always_supported() { return true; }
+
+template <std::uint32_t RULE>
+static void packed_row_scalar(const PackedBoard::Word *above,
+                              const PackedBoard::Word *row,
+                              const PackedBoard::Word *below,
+                              PackedBoard::Word *next, size_t begin,
+                              size_t end) {
+  packed_row_kernel<RULE, PackedBoard::Word, 1>(above, row, below, next, begin,
+                                                end);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+typedef PackedBoard::Word Word128 __attribute__((vector_size(16)));
+typedef PackedBoard::Word Word256 __attribute__((vector_size(32)));
+typedef PackedBoard::Word Word512 __attribute__((vector_size(64)));
+
+static bool avx2_supported() { return __builtin_cpu_supports("avx2"); }
+static bool avx512_supported() { return __builtin_cpu_supports("avx512f"); }
+static bool sse2_supported() { return __builtin_cpu_supports("sse2"); }
+
+template <std::uint32_t RULE>
+__attribute__((target("avx512f"))) static void
+packed_row_avx512(const PackedBoard::Word *above, const PackedBoard::Word *row,
+                  const PackedBoard::Word *below, PackedBoard::Word *next,
+                  size_t begin, size_t end) {
+  packed_row_kernel<RULE, Word512, 8>(above, row, below, next, begin, end);
+}
+
+template <std::uint32_t RULE>
+__attribute__((target("avx2"))) static void
+packed_row_avx2(const PackedBoard::Word *above, const PackedBoard::Word *row,
+                const PackedBoard::Word *below, PackedBoard::Word *next,
+                size_t begin, size_t end) {
+  packed_row_kernel<RULE, Word256, 4>(above, row, below, next, begin, end);
+}
+
+template <std::uint32_t RULE>
+__attribute__((target("sse2"))) static void
+packed_row_sse2(const PackedBoard::Word *above, const PackedBoard::Word *row,
+                const PackedBoard::Word *below, PackedBoard::Word *next,
+                size_t begin, size_t end) {
+  packed_row_kernel<RULE, Word128, 2>(above, row, below, next, begin, end);
+}
+#elif defined(__ARM_NEON)
+typedef PackedBoard::Word Word128 __attribute__((vector_size(16)));
+
+template <std::uint32_t RULE>
+static void packed_row_neon(const PackedBoard::Word *above,
+                            const PackedBoard::Word *row,
+                            const PackedBoard::Word *below,
+                            PackedBoard::Word *next, size_t begin,
+                            size_t end) {
+  packed_row_kernel<RULE, Word128, 2>(above, row, below, next, begin, end);
+}
+#endif
+
+/// Packed kernels of a rule, for every instruction set in the same order
+template <std::uint32_t RULE>
+static const std::vector<PackedKernel> &rule_kernels() {
+  static const std::vector<PackedKernel> kernels{
+#if defined(__x86_64__) || defined(__i386__)
+      {"avx512", avx512_supported, packed_row_avx512<RULE>},
+      {"avx2", avx2_supported, packed_row_avx2<RULE>},
+      {"sse2", sse2_supported, packed_row_sse2<RULE>},
+#elif defined(__ARM_NEON)
+      {"neon", always_supported, packed_row_neon<RULE>},
+#endif
+      {"scalar", always_supported, packed_row_scalar<RULE>}};
+  return kernels;
+}
+
+size_t update_board(const PackedBoard &board, PackedBoard &next_board) {
+  return update_board(board, next_board, 0, board.height());
+}
+
+size_t update_board(const PackedBoard &board, PackedBoard &next_board,
+                  size_t first_row, size_t last_row) {
+  return update_board(board, next_board, first_row, last_row, 0,
+                      board.width());
+}
+
+/// Packed stepper of a rule, GENERIC_RULE reading it from generic_code
+template <std::uint32_t RULE>
+static size_t update_packed_board_with(const PackedBoard &board,
+                                       PackedBoard &next_board,
+                                       size_t first_row, size_t last_row,
+                                       size_t first_column,
+                                       size_t last_column) {
+  typedef PackedBoard::Word Word;
+  const size_t height = board.height();
+  const size_t words = board.words_per_row();
+  const PackedRowKernel kernel = packed_kernel().kernel;
+  const size_t first_word = first_column / PackedBoard::WORD_BITS;
+  const size_t last_word =
+      (last_column + PackedBoard::WORD_BITS - 1) / PackedBoard::WORD_BITS;
+  const size_t interior_begin = std::max<size_t>(first_word, 1);
+  const size_t interior_end = std::min(last_word, words - 1);
+  size_t population = 0;
+
+  // The first and the last words of a row wrap around it, so they go through
+  // shifted_words while the interior of the row is left to the kernel.
+  const auto update_edge = [&](const Word *above, const Word *row,
+                               const Word *below, Word *next_row, size_t k) {
+    Word above_w, above_e, row_w, row_e, below_w, below_e;
+    shifted_words(above, k, board, above_w, above_e);
+    shifted_words(row, k, board, row_w, row_e);
+    shifted_words(below, k, board, below_w, below_e);
+    next_row[k] = next_cells<RULE>(above_w, above[k], above_e, row_w, row[k],
+                                   row_e, below_w, below[k], below_e);
+  };
+
+  for (size_t i = first_row; i < last_row; ++i) {
+    const Word *above = board.row(i == 0 ? height - 1 : i - 1);
+    const Word *row = board.row(i);
+    const Word *below = board.row(i + 1 == height ? 0 : i + 1);
+    Word *next_row = next_board.row(i);
+
+    if (first_word == 0)
+      update_edge(above, row, below, next_row, 0);
+    if (interior_begin < interior_end)
+      kernel(above, row, below, next_row, interior_begin, interior_end);
+    if (last_word == words && words > 1)
+      update_edge(above, row, below, next_row, words - 1);
+    if (last_word == words)
+      next_row[words - 1] &= board.last_word_mask();
+    population +=
+        count_living_cells(next_row + first_word, next_row + last_word);
+  }
+  return population;
+}
+
+/// Steppers instantiated for a rule
+struct RuleSteppers {
+  std::uint32_t code;
+  size_t (*board)(const Board &, Board &, size_t, size_t, size_t, size_t);
+  size_t (*packed)(const PackedBoard &, PackedBoard &, size_t, size_t, size_t,
+                   size_t);
+  const std::vector<PackedKernel> &(*kernels)();
+};
+
+template <std::uint32_t RULE> static constexpr RuleSteppers rule_steppers() {
+  return {RULE, update_board_with<RULE>, update_packed_board_with<RULE>,
+          rule_kernels<RULE>};
+}
+
+static const RuleSteppers COMPILED_RULES[] = {
+    rule_steppers<rule_code("B3/S23")>(),
+    rule_steppers<rule_code("B36/S23")>(),
+    rule_steppers<rule_code("B3678/S34678")>(),
+    rule_steppers<rule_code("B2/S")>(),
+    rule_steppers<rule_code("B3/S012345678")>(),
+    rule_steppers<rule_code("B3/S12345")>(),
+    rule_steppers<rule_code("B1357/S1357")>(),
+    rule_steppers<rule_code("B368/S245")>()};
+
+static const RuleSteppers GENERIC_STEPPERS = rule_steppers<GENERIC_RULE>();
+
+static const RuleSteppers *selected_steppers = COMPILED_RULES;
+
+bool select_rule(const Rule &rule) {
+  current_rule = rule;
+  for (const RuleSteppers &steppers : COMPILED_RULES) {
+    if (steppers.code == rule.code()) {
+      selected_steppers = &steppers;
+      return true;
+    }
+  }
+  generic_code = rule.code();
+  generic_table = block_table(generic_code);
+  selected_steppers = &GENERIC_STEPPERS;
+  return false;
+}
+
+size_t update_board(const Board &board, Board &next_board, size_t first_row,
+                    size_t last_row, size_t first_column, size_t last_column) {
+  PROFILE_SCOPE("update_rows");
+  PROFILE_COUNT("cell_updates",
+                (last_row - first_row) * (last_column - first_column));
+  return selected_steppers->board(board, next_board, first_row, last_row,
+                                  first_column, last_column);
+}
+
+size_t update_board(const PackedBoard &board, PackedBoard &next_board,
+                    size_t first_row, size_t last_row, size_t first_column,
+                    size_t last_column) {
+  PROFILE_SCOPE("update_rows");
+  PROFILE_COUNT("cell_updates",
+                (last_row - first_row) * (last_column - first_column));
+  return selected_steppers->packed(board, next_board, first_row, last_row,
+                                   first_column, last_column);
+}
+
+const std::vector<PackedKernel> &packed_kernels() {
+  return selected_steppers->kernels();
+}
+
+/// Index of the selected kernel in packed_kernels, the same for every rule
+static size_t selected_packed_kernel = 0;
+static bool packed_kernel_selected = false;
+
+const PackedKernel &packed_kernel() {
+  const auto &kernels = packed_kernels();
+  if (!packed_kernel_selected) {
+    selected_packed_kernel =
+        std::find_if(kernels.begin(), kernels.end(),
+                     [](const PackedKernel &kernel) {
+                       return kernel.supported();
+                     }) -
+        kernels.begin();
+    packed_kernel_selected = true;
+  }
+  return kernels[selected_packed_kernel];
+}
+
+bool select_packed_kernel(const std::string &name) {
+  const auto &kernels = packed_kernels();
+  for (size_t k = 0; k < kernels.size(); ++k) {
+    if (name == kernels[k].name && kernels[k].supported()) {
+      selected_packed_kernel = k;
+      packed_kernel_selected = true;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool is_region_equal(const PackedBoard &board, const PackedBoard &other,
+                     size_t first_row, size_t last_row, size_t first_column,
+                     size_t last_column) {
+  const size_t first_word = first_column / PackedBoard::WORD_BITS;
+  const size_t last_word =
+      (last_column + PackedBoard::WORD_BITS - 1) / PackedBoard::WORD_BITS;
+  for (size_t i = first_row; i < last_row; ++i) {
+    if (!std::equal(board.row(i) + first_word, board.row(i) + last_word,
+                    other.row(i) + first_word))
+      return false;
+  }
+  return true;
+}
+
+bool is_region_dead(const PackedBoard &board, size_t first_row,
+                    size_t last_row, size_t first_column, size_t last_column) {
+  const size_t words = board.words_per_row();
+  const size_t height = board.height();
+  const size_t first_word = first_column / PackedBoard::WORD_BITS;
+  const size_t last_word =
+      (last_column + PackedBoard::WORD_BITS - 1) / PackedBoard::WORD_BITS;
+  const size_t left = first_word == 0 ? words - 1 : first_word - 1;
+  const size_t right = last_word == words ? 0 : last_word;
+
+  for (size_t n = 0; n < last_row - first_row + 2; ++n) {
+    const PackedBoard::Word *row =
+        board.row((first_row + height - 1 + n) % height);
+    if (row[left] || row[right] ||
+        std::any_of(row + first_word, row + last_word,
+                    [](PackedBoard::Word word) { return word != 0; }))
+      return false;
+  }
+  return true;
+}
+
+void clear_region(PackedBoard &board, size_t first_row, size_t last_row,
+                  size_t first_column, size_t last_column) {
+  const size_t first_word = first_column / PackedBoard::WORD_BITS;
+  const size_t last_word =
+      (last_column + PackedBoard::WORD_BITS - 1) / PackedBoard::WORD_BITS;
+  for (size_t i = first_row; i < last_row; ++i)
+    std::fill(board.row(i) + first_word, board.row(i) + last_word, 0);
+}
+
+bool is_everybody_dead(const PackedBoard &board) {
+  PROFILE_SCOPE("is_everybody_dead");
+  for (size_t i = 0; i < board.height(); ++i) {
+    if (std::any_of(board.row(i), board.row(i) + board.words_per_row(),
+                    [](PackedBoard::Word word) { return word != 0; }))
+      return false;
+  }
+  return true;
+}
+
+ThreadPool::ThreadPool(size_t threads) {
+  for (size_t i = 1; i < threads; ++i)
+    workers.emplace_back(&ThreadPool::work, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  start.notify_all();
+  for (std::thread &worker : workers)
+    worker.join();
+}
+
+void ThreadPool::run(const std::function<void(size_t)> &new_task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    task = &new_task;
+    pending = workers.size();
+    generation++;
+  }
+  start.notify_all();
+  new_task(0);
+
+  std::unique_lock<std::mutex> lock(mutex);
+  done.wait(lock, [this] { return pending == 0; });
+}
+
+void ThreadPool::work(size_t index) {
+  size_t last_generation = 0;
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while (true) {
+    start.wait(lock,
+               [&] { return stopping || generation != last_generation; });
+    if (stopping)
+      return;
+    last_generation = generation;
+
+    lock.unlock();
+    (*task)(index);
+    lock.lock();
+
+    if (--pending == 0)
+      done.notify_one();
+  }
+}
+
+TileScheduler::TileScheduler(size_t threads)
+    : queues(threads),
+      work([this](size_t thread) {
+        size_t tile;
+        while (take(thread, tile) || steal(thread, tile))
+          (*task)(tile);
+      }) {}
+
+void TileScheduler::run(ThreadPool *pool, size_t tiles,
+                        const std::function<void(size_t)> &new_task) {
+  if (!pool) {
+    for (size_t tile = 0; tile < tiles; ++tile)
+      new_task(tile);
+    return;
+  }
+
+  const size_t threads = std::min(queues.size(), pool->size());
+  for (size_t i = 0; i < queues.size(); ++i) {
+    const std::uint64_t first = i < threads ? tiles * i / threads : 0;
+    const std::uint64_t last = i < threads ? tiles * (i + 1) / threads : 0;
+    queues[i].range.store(first << 32 | last, std::memory_order_relaxed);
+  }
+  task = &new_task;
+  pool->run(work);
+}
+
+bool TileScheduler::take(size_t thread, size_t &tile) {
+  if (thread >= queues.size())
+    return false;
+  std::atomic<std::uint64_t> &range = queues[thread].range;
+  std::uint64_t current = range.load(std::memory_order_relaxed);
+
+  while (true) {
+    const std::uint64_t first = current >> 32, last = current & 0xffffffff;
+    if (first >= last)
+      return false;
+    if (range.compare_exchange_weak(current, (first + 1) << 32 | last,
+                                    std::memory_order_relaxed)) {
+      tile = first;
+      return true;
+    }
+  }
+}
+
+bool TileScheduler::steal(size_t thread, size_t &tile) {
+  for (size_t n = 1; n < queues.size(); ++n) {
+    std::atomic<std::uint64_t> &range =
+        queues[(thread + n) % queues.size()].range;
+    std::uint64_t current = range.load(std::memory_order_relaxed);
+
+    while (true) {
+      const std::uint64_t first = current >> 32, last = current & 0xffffffff;
+      if (first >= last)
+        break;
+      if (range.compare_exchange_weak(current, first << 32 | (last - 1),
+                                      std::memory_order_relaxed)) {
+        tile = last - 1;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+size_t count_living_cells(const Board &board) {
+  PROFILE_SCOPE("count_living_cells");
+  size_t population = 0;
+  for (size_t i = 0; i < board.height(); ++i)
+    population += std::count(board.row(i), board.row(i) + board.width(),
+                             Cell::alive);
+  return population;
+}
+
+size_t count_living_cells(const PackedBoard &board) {
+  PROFILE_SCOPE("count_living_cells");
+  return count_living_cells(board.row(0), board.row(board.height()));
+}
+
+size_t count_living_cells(const PackedBoard::Word *first,
+                          const PackedBoard::Word *last) {
+  size_t population = 0;
+  for (; first != last; ++first)
+    population += __builtin_popcountll(*first);
+  return population;
+}
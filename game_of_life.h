@@ -0,0 +1,1202 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file declares the boards, the steppers and the renderer of Conway's
+ * Game of Life, shared by the game (main.cpp) and its benchmarks
+ * (benchmark.cpp). The implementations live in game_of_life.cpp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#ifndef GAME_OF_LIFE_H
+#define GAME_OF_LIFE_H
+
+#include "grid_memory.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * Possible cell's states in the game.
+ * These values are used to impose the only two states a cell can assume during
+ * the game.
+ */
+enum class Cell : std::uint8_t { dead, alive };
+
+/**
+ * Rectangular grid of cells stored contiguously in row-major order.
+ *
+ * Each row starts stride() cells after the previous one. The stride may be
+ * larger than the width so every row starts on a cache line boundary; the
+ * padding cells are kept dead and are never part of the game.
+ */
+class Board {
+public:
+  static const size_t TILE_WIDTH = 64; ///< Columns of a tile of the board
+
+  Board() = default;
+
+  /**
+   * Creates a board with all cells set to the same state.
+   *
+   * @param width size_t with the number of columns.
+   * @param height size_t with the number of rows.
+   * @param stride size_t with the distance, in cells, between two rows. It
+   * must not be smaller than width.
+   * @param initial_value Cell with the initial state of all cells.
+   */
+  Board(size_t width, size_t height, size_t stride, Cell initial_value);
+
+  /// Creates an unpadded board filled with dead cells
+  Board(size_t width, size_t height)
+      : Board(width, height, width, Cell::dead) {}
+
+  /**
+   * Creates a board over cells it does not allocate, such as the memory of
+   * map_grid_memory, which are used in place.
+   *
+   * @param width size_t with the number of columns.
+   * @param height size_t with the number of rows.
+   * @param stride size_t with the distance, in cells, between two rows.
+   * @param storage shared_ptr to the first cell of stride * height cells,
+   * keeping them alive as long as the board uses them.
+   */
+  Board(size_t width, size_t height, size_t stride,
+        std::shared_ptr<Cell> storage);
+
+  /// Copies always own their cells, even when the original does not
+  Board(const Board &other);
+  Board &operator=(const Board &other);
+  /// Moves leave the original empty, as copies may write into its memory
+  Board(Board &&other) noexcept;
+  Board &operator=(Board &&other) noexcept;
+
+  size_t width() const { return columns; }
+  size_t height() const { return rows; }
+  size_t stride() const { return row_stride; }
+
+  /// Pointer to the first cell of the i-th row
+  Cell *row(size_t i) { return data + i * row_stride; }
+  const Cell *row(size_t i) const { return data + i * row_stride; }
+
+  Cell &operator()(size_t i, size_t j) { return row(i)[j]; }
+  Cell operator()(size_t i, size_t j) const { return row(i)[j]; }
+  Cell get(size_t i, size_t j) const { return row(i)[j]; }
+  void set(size_t i, size_t j, Cell cell) { row(i)[j] = cell; }
+
+private:
+  size_t columns = 0;
+  size_t rows = 0;
+  size_t row_stride = 0;
+  std::vector<Cell> cells;
+  std::shared_ptr<Cell> storage; ///< Cells not owned by the board, if any
+  Cell *data = nullptr;          ///< First cell of the rows
+};
+
+const std::string ALIVE_SYMBOL = " o "; ///< Symbol used in terminal to represents a live cell
+const std::string DEAD_SYMBOL = " _ "; ///<  Symbol used in terminal to represents a dead cell
+const int MIN_NEIGHBOURS = 2; ///< Game constant to define underpopulation
+const int MAX_NEIGHBOURS = 3; ///< Game constant to define overpopuplation
+
+const size_t CACHE_LINE_SIZE = 64; ///< Alignment in bytes of padded rows
+const size_t TILE_SIZE = 64; ///< Rows of the tiles of a board
+
+/// Relative positions (row, column) of the eight neighbours of a cell
+const std::array<std::pair<int, int>, 8> NEIGHBOURHOOD{
+    {{-1, 0}, {0, -1}, {1, 0}, {0, 1}, {1, 1}, {-1, -1}, {-1, 1}, {1, -1}}};
+
+/**
+ * Life-like rule in B/S notation, e.g. B3/S23 for Conway's Game of Life.
+ *
+ * Bit n of birth is set when a dead cell with n living neighbours comes to
+ * life, and bit n of survival when a living cell with n living neighbours
+ * stays alive.
+ */
+struct Rule {
+  std::uint16_t birth;
+  std::uint16_t survival;
+
+  /// Both masks in one integer, birth in the low 9 bits
+  constexpr std::uint32_t code() const {
+    return birth | std::uint32_t(survival) << 9;
+  }
+  bool operator==(const Rule &other) const { return code() == other.code(); }
+};
+
+/// Rule of Conway's Game of Life, used until another one is selected
+constexpr Rule CONWAY_RULE{1 << 3, 1 << 2 | 1 << 3};
+
+/**
+ * Parses a rulestring in B/S notation, such as B36/S23.
+ *
+ * Rules with B0 are rejected, as they would bring the dead background of the
+ * unbounded engines to life.
+ *
+ * @param rulestring const std::string with the rule, letters in any case.
+ * @param rule Rule passed by reference that receives the parsed rule.
+ * @return bool true if the rulestring is a valid rule.
+ */
+bool parse_rule(const std::string &rulestring, Rule &rule);
+
+/**
+ * Formats a rule in B/S notation.
+ *
+ * @param rule const Rule to be formatted.
+ * @return std::string such as "B36/S23".
+ */
+std::string rule_string(const Rule &rule);
+
+/**
+ * Selects the rule used by every stepper.
+ *
+ * The steppers of B3/S23, B36/S23 (HighLife), B3678/S34678 (Day & Night),
+ * B2/S (Seeds), B3/S012345678 (Life without Death), B3/S12345 (Maze),
+ * B1357/S1357 (Replicator) and B368/S245 (Morley) are instantiated at compile
+ * time with the rule folded into them. Any other rule runs generic steppers
+ * reading it at run time. It must not be called while a World is stepping.
+ *
+ * @param rule const Rule to be selected.
+ * @return bool true if the rule has compiled steppers.
+ */
+bool select_rule(const Rule &rule);
+
+/// Rule selected by select_rule
+const Rule &selected_rule();
+
+/**
+ * Creates a square board to the game of life
+ *
+ * @param size size_t whose value is used to create a square board.
+ * @param initial_value Cell indicates the initial state of all cells in the
+ * board, the default value is set to Cell::dead
+ * @return a new Board with the configurations established by the parameters
+ * above.
+ */
+
+Board board_factory(size_t size, Cell initial_value = Cell::dead);
+
+/**
+ * Creates a rectangular board to the game of life
+ *
+ * @param width size_t with the number of columns of the board.
+ * @param height size_t with the number of rows of the board.
+ * @param initial_value Cell indicates the initial state of all cells in the
+ * board.
+ * @param padded bool, when true each row is padded to a multiple of
+ * CACHE_LINE_SIZE bytes.
+ * @return a new Board with the configurations established by the parameters
+ * above.
+ */
+Board board_factory(size_t width, size_t height, Cell initial_value,
+                    bool padded = false);
+
+/**
+ * Draws a seed from std::random_device, for the games without --seed.
+ *
+ * @return uint64_t with a new random seed.
+ */
+std::uint64_t random_seed();
+
+/// Finalizer of SplitMix64, mixing every bit of x into every bit of the result
+inline std::uint64_t mix_bits(std::uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+/**
+ * Number counter of the random stream key.
+ *
+ * Any number of the stream is computed on its own, so the threads filling a
+ * board draw the same numbers whatever rows they are given.
+ */
+inline std::uint64_t counter_random(std::uint64_t key,
+                                    std::uint64_t counter) {
+  return mix_bits(key + (counter + 1) * 0x9E3779B97F4A7C15ull);
+}
+
+/**
+ * Populates the board with exactly the given number of random living cells.
+ *
+ * Every cell is drawn from a counter-based random stream indexed by its
+ * position, so the cells only depend on the seed and the size of the board:
+ * the same layout comes out with any number of threads, and on a Board or a
+ * PackedBoard alike. The board is first filled at the density of
+ * number_of_cells, then random cells are added or removed until the count is
+ * exact, which keeps every layout equally likely.
+ *
+ * @param board Board passsed by reference to be populated, expected dead.
+ * @param number_of_cells size_t defines the number of cells set as
+ * Cell::alive, at most the number of cells of the board.
+ * @param seed uint64_t selecting the random layout.
+ * @param threads size_t with the number of threads filling the board.
+ */
+void generates_board_initial_state(Board &board, size_t number_of_cells,
+                                   std::uint64_t seed = random_seed(),
+                                   size_t threads = 1);
+
+/**
+ * Populates the board with random living cells at the given density.
+ *
+ * Each cell is alive with probability density, rounded to a multiple of
+ * 2^-32, from the same random streams as generates_board_initial_state.
+ *
+ * @param board Board passsed by reference to be populated, expected dead.
+ * @param density double with the probability of a living cell, from 0 to 1.
+ * @param seed uint64_t selecting the random layout.
+ * @param threads size_t with the number of threads filling the board.
+ */
+void generates_board_random_state(Board &board, double density,
+                                  std::uint64_t seed = random_seed(),
+                                  size_t threads = 1);
+
+/**
+ * Prints the Board on the standard output
+ *
+ * Uses the ALIVE_SYMBOL and the DEAD_SYMBOL to represents the cells state.
+ *
+ * @param board Board passed as const reference to be printed
+ */
+
+void print_board(const Board &board);
+
+/**
+ * Updates a board using the three rules of Conway's Game of Life.
+ *
+ * This is the reference implementation, a chain of branches on the number of
+ * neighbours that always follows B3/S23 whatever the selected rule.
+ *
+ * @param board Board passed by referece to be updated.
+ */
+void update_board(Board &board);
+
+/**
+ * Computes the next generation of a board into another board.
+ *
+ * Every cell of next_board is overwritten, so it can be reused from one
+ * generation to the next without being cleared. The selected rule is applied
+ * by looking up the next state of each 2x2 block of cells in a table indexed
+ * by the 4x4 cells around it, built at compile time for the rules with
+ * compiled steppers.
+ *
+ * @param board Board passed as const reference with the current generation.
+ * @param next_board Board passed by reference, with the same size as board,
+ * that receives the next generation.
+ * @return size_t with the number of living cells written to next_board.
+ */
+size_t update_board(const Board &board, Board &next_board);
+
+/**
+ * Computes the next generation of a band of rows of a board.
+ *
+ * @param board Board passed as const reference with the current generation.
+ * @param next_board Board passed by reference that receives the rows of the
+ * next generation.
+ * @param first_row size_t with the first row of the band.
+ * @param last_row size_t past the last row of the band.
+ * @return size_t with the number of living cells written to next_board.
+ */
+size_t update_board(const Board &board, Board &next_board, size_t first_row,
+                  size_t last_row);
+
+/**
+ * Computes the next generation of a rectangular region of a board.
+ *
+ * @param board Board passed as const reference with the current generation.
+ * @param next_board Board passed by reference that receives the region of the
+ * next generation.
+ * @param first_row size_t with the first row of the region.
+ * @param last_row size_t past the last row of the region.
+ * @param first_column size_t with the first column of the region.
+ * @param last_column size_t past the last column of the region.
+ * @return size_t with the number of living cells written to next_board.
+ */
+size_t update_board(const Board &board, Board &next_board, size_t first_row,
+                  size_t last_row, size_t first_column, size_t last_column);
+
+/**
+ * Checks if a rectangular region holds the same cells in two boards.
+ *
+ * @param board Board passed as a const reference.
+ * @param other Board of the same size passed as a const reference.
+ * @param first_row size_t with the first row of the region.
+ * @param last_row size_t past the last row of the region.
+ * @param first_column size_t with the first column of the region.
+ * @param last_column size_t past the last column of the region.
+ * @return bool true if every cell of the region is the same in both boards.
+ */
+bool is_region_equal(const Board &board, const Board &other, size_t first_row,
+                     size_t last_row, size_t first_column, size_t last_column);
+
+/**
+ * Checks if a rectangular region of a board and the cells around it are dead.
+ *
+ * The cells around the region wrap around the board, so when this returns
+ * true the region is dead in the next generation as well.
+ *
+ * @param board Board passed as a const reference.
+ * @param first_row size_t with the first row of the region.
+ * @param last_row size_t past the last row of the region.
+ * @param first_column size_t with the first column of the region.
+ * @param last_column size_t past the last column of the region.
+ * @return bool true if there is no living cell in or around the region.
+ */
+bool is_region_dead(const Board &board, size_t first_row, size_t last_row,
+                    size_t first_column, size_t last_column);
+
+/**
+ * Sets all cells of a rectangular region of a board as dead.
+ *
+ * @param board Board passed by reference to be cleared.
+ * @param first_row size_t with the first row of the region.
+ * @param last_row size_t past the last row of the region.
+ * @param first_column size_t with the first column of the region.
+ * @param last_column size_t past the last column of the region.
+ */
+void clear_region(Board &board, size_t first_row, size_t last_row,
+                  size_t first_column, size_t last_column);
+
+/**
+ * Gets a valid position of the neighbour of a cell
+ *
+ * @param coord const Container with the Board indexes of a cell.
+ * @param positions const Container with the directions of the neighbour to be
+ * calculated.
+ * @param board_size size_t with the size of the Board.
+ * @return std::pair<int,int> with the indexes of the neighbour in the given
+ * direction.
+ */
+std::pair<int, int> neighbour_position(const std::vector<int> &coord,
+                                       const std::vector<size_t> &positions,
+                                       size_t board_size);
+
+/**
+ * Runs through a Board looking for a living cell
+ *
+ * @param board Board passed as a const reference
+ * @return bool return true if all cells are marked as dead, false if there is
+ * at least one cell alive.
+ * @note if the cell is on the edge of the board the neighbours will be set as
+ * the cells in the on the other side of the board, creating the illusion of a
+ * round board.
+ */
+
+bool is_everybody_dead(const Board &board);
+
+/**
+ * Counts the living cells of a board
+ *
+ * @param board Board passed as a const reference
+ * @return size_t with the number of cells marked as Cell::alive.
+ */
+size_t count_living_cells(const Board &board);
+
+/**
+ * Rectangular grid storing one cell per bit.
+ *
+ * Each row is made of words_per_row() 64 bit words, and bit b of word k holds
+ * the cell of column 64 * k + b. The bits past the last column of a row are
+ * kept at zero.
+ */
+class PackedBoard {
+public:
+  typedef std::uint64_t Word;
+  static const size_t WORD_BITS = 64; ///< Number of cells in a Word
+  /// Columns of a tile of the board, wide enough for the vector kernels
+  static const size_t TILE_WIDTH = 8 * WORD_BITS;
+
+  PackedBoard() = default;
+
+  /**
+   * Creates a packed board filled with dead cells.
+   *
+   * @param width size_t with the number of columns.
+   * @param height size_t with the number of rows.
+   */
+  PackedBoard(size_t width, size_t height);
+
+  /**
+   * Creates a packed board over words it does not allocate, such as the
+   * payload of a memory mapped snapshot, which are used in place.
+   *
+   * @param width size_t with the number of columns.
+   * @param height size_t with the number of rows.
+   * @param storage shared_ptr to the first word of the rows, stored one after
+   * the other, keeping the words alive as long as the board uses them.
+   */
+  PackedBoard(size_t width, size_t height, std::shared_ptr<Word> storage);
+
+  /// Copies always own their words, even when the original does not
+  PackedBoard(const PackedBoard &other);
+  PackedBoard &operator=(const PackedBoard &other);
+  /// Moves leave the original empty, as copies may write into its words
+  PackedBoard(PackedBoard &&other) noexcept;
+  PackedBoard &operator=(PackedBoard &&other) noexcept;
+
+  size_t width() const { return columns; }
+  size_t height() const { return rows; }
+  size_t words_per_row() const { return row_words; }
+
+  /// Pointer to the first word of the i-th row
+  Word *row(size_t i) { return data + i * row_words; }
+  const Word *row(size_t i) const { return data + i * row_words; }
+
+  /// Mask of the valid cells in the last word of every row
+  Word last_word_mask() const { return last_mask; }
+
+  Cell get(size_t i, size_t j) const {
+    return (row(i)[j / WORD_BITS] >> (j % WORD_BITS)) & 1 ? Cell::alive
+                                                          : Cell::dead;
+  }
+
+  void set(size_t i, size_t j, Cell cell) {
+    const Word bit = Word(1) << (j % WORD_BITS);
+    Word &word = row(i)[j / WORD_BITS];
+    word = cell == Cell::alive ? word | bit : word & ~bit;
+  }
+
+private:
+  size_t columns = 0;
+  size_t rows = 0;
+  size_t row_words = 0;
+  Word last_mask = 0;
+  std::vector<Word> words;
+  std::shared_ptr<Word> storage; ///< Words not owned by the board, if any
+  Word *data = nullptr;          ///< First word of the rows
+};
+
+/**
+ * Converts a Board into a PackedBoard with the same cells.
+ *
+ * @param board Board passed as const reference to be packed.
+ * @return a new PackedBoard with the same size and cells of board.
+ */
+PackedBoard pack_board(const Board &board);
+
+/**
+ * Converts a PackedBoard into a Board with the same cells.
+ *
+ * @param board PackedBoard passed as const reference to be unpacked.
+ * @return a new Board with the same size and cells of board.
+ */
+Board unpack_board(const PackedBoard &board);
+
+/**
+ * Creates a grid of dead cells over memory of map_grid_memory, whose pages
+ * are placed by the first thread writing them. A Board is unpadded, as the
+ * grids of a World.
+ *
+ * @tparam Grid Board or PackedBoard to be created.
+ * @param width size_t with the number of columns.
+ * @param height size_t with the number of rows.
+ * @param huge_pages bool, true to ask for huge pages.
+ * @param pages PageKind passed by reference, set to the pages obtained.
+ * @throws std::bad_alloc if no memory can be mapped.
+ */
+template <typename Grid>
+Grid map_grid(size_t width, size_t height, bool huge_pages, PageKind &pages);
+template <>
+Board map_grid<Board>(size_t width, size_t height, bool huge_pages,
+                      PageKind &pages);
+template <>
+PackedBoard map_grid<PackedBoard>(size_t width, size_t height, bool huge_pages,
+                                  PageKind &pages);
+
+/// Bytes of memory holding the rows of a grid
+inline size_t grid_bytes(const Board &board) {
+  return board.stride() * board.height() * sizeof(Cell);
+}
+inline size_t grid_bytes(const PackedBoard &board) {
+  return board.words_per_row() * board.height() * sizeof(PackedBoard::Word);
+}
+
+/// Populates the packed board, a word of 64 cells at a time
+void generates_board_initial_state(PackedBoard &board, size_t number_of_cells,
+                                   std::uint64_t seed = random_seed(),
+                                   size_t threads = 1);
+void generates_board_random_state(PackedBoard &board, double density,
+                                  std::uint64_t seed = random_seed(),
+                                  size_t threads = 1);
+
+/**
+ * Building blocks of the random boards, for boards filled in pieces such as
+ * the blocks of a distributed world, which get the same cells as a whole
+ * board.
+ *
+ * The density of a board is a threshold, a multiple of 2^-32: the one of
+ * generates_board_random_state is random_density_threshold(density) and the
+ * one generates_board_initial_state starts from is random_count_threshold.
+ * random_cells draws the word at index row * words_per_row + word of a
+ * PackedBoard, where words_per_row counts the partial last word. The cells
+ * then flipped to reach the exact count are the random_cell of each draw
+ * from 0 onwards, as an index i * width + j, skipping those that already
+ * have the right state.
+ */
+std::uint64_t random_density_threshold(double density);
+std::uint64_t random_count_threshold(size_t number_of_cells, size_t cells);
+PackedBoard::Word random_cells(std::uint64_t seed, std::uint64_t index,
+                               std::uint64_t threshold);
+size_t random_cell(std::uint64_t seed, std::uint64_t draw, size_t cells);
+
+/**
+ * Prints the PackedBoard on the standard output
+ *
+ * @param board PackedBoard passed as const reference to be printed
+ */
+void print_board(const PackedBoard &board);
+
+/**
+ * Computes the next generation of a packed board into another one.
+ *
+ * The eight neighbours of 64 cells are summed at once with bitwise full
+ * adders over shifted copies of the rows above, below and of the row itself,
+ * following the same toroidal wrap as update_board on a Board. The selected
+ * rule is then applied to the bits of the sums.
+ *
+ * @param board PackedBoard passed as const reference with the current
+ * generation.
+ * @param next_board PackedBoard passed by reference, with the same size as
+ * board, that receives the next generation.
+ * @return size_t with the number of living cells written to next_board.
+ */
+size_t update_board(const PackedBoard &board, PackedBoard &next_board);
+
+/**
+ * Computes the next generation of a band of rows of a packed board.
+ *
+ * @param board PackedBoard passed as const reference with the current
+ * generation.
+ * @param next_board PackedBoard passed by reference that receives the rows of
+ * the next generation.
+ * @param first_row size_t with the first row of the band.
+ * @param last_row size_t past the last row of the band.
+ * @return size_t with the number of living cells written to next_board.
+ */
+size_t update_board(const PackedBoard &board, PackedBoard &next_board,
+                  size_t first_row, size_t last_row);
+
+/**
+ * Computes the next generation of a rectangular region of a packed board.
+ *
+ * The columns of the region must be multiples of PackedBoard::WORD_BITS, or
+ * the width of the board for the last column.
+ *
+ * @param board PackedBoard passed as const reference with the current
+ * generation.
+ * @param next_board PackedBoard passed by reference that receives the region
+ * of the next generation.
+ * @param first_row size_t with the first row of the region.
+ * @param last_row size_t past the last row of the region.
+ * @param first_column size_t with the first column of the region.
+ * @param last_column size_t past the last column of the region.
+ * @return size_t with the number of living cells written to next_board.
+ */
+size_t update_board(const PackedBoard &board, PackedBoard &next_board,
+                  size_t first_row, size_t last_row, size_t first_column,
+                  size_t last_column);
+
+/**
+ * Checks if a rectangular region holds the same cells in two packed boards.
+ *
+ * The columns of the region follow the same rule as the packed update_board.
+ *
+ * @param board PackedBoard passed as a const reference.
+ * @param other PackedBoard of the same size passed as a const reference.
+ * @param first_row size_t with the first row of the region.
+ * @param last_row size_t past the last row of the region.
+ * @param first_column size_t with the first column of the region.
+ * @param last_column size_t past the last column of the region.
+ * @return bool true if every cell of the region is the same in both boards.
+ */
+bool is_region_equal(const PackedBoard &board, const PackedBoard &other,
+                     size_t first_row, size_t last_row, size_t first_column,
+                     size_t last_column);
+
+/**
+ * Checks if a rectangular region of a packed board and the cells around it
+ * are dead.
+ *
+ * The columns of the region follow the same rule as the packed update_board.
+ * The words on each side of the region are checked as a whole, so the region
+ * may be reported alive because of a cell that is not its neighbour.
+ *
+ * @param board PackedBoard passed as a const reference.
+ * @param first_row size_t with the first row of the region.
+ * @param last_row size_t past the last row of the region.
+ * @param first_column size_t with the first column of the region.
+ * @param last_column size_t past the last column of the region.
+ * @return bool true if there is no living cell in or around the region.
+ */
+bool is_region_dead(const PackedBoard &board, size_t first_row,
+                    size_t last_row, size_t first_column, size_t last_column);
+
+/**
+ * Sets all cells of a rectangular region of a packed board as dead.
+ *
+ * The columns of the region follow the same rule as the packed update_board.
+ *
+ * @param board PackedBoard passed by reference to be cleared.
+ * @param first_row size_t with the first row of the region.
+ * @param last_row size_t past the last row of the region.
+ * @param first_column size_t with the first column of the region.
+ * @param last_column size_t past the last column of the region.
+ */
+void clear_region(PackedBoard &board, size_t first_row, size_t last_row,
+                  size_t first_column, size_t last_column);
+
+/**
+ * Kernel computing the next generation of a range of words of a packed row.
+ *
+ * Only words that are not on the edges of the row are handled, so the words
+ * begin - 1 and end are always valid and no wrap is needed.
+ *
+ * @param above const pointer to the row above.
+ * @param row const pointer to the row being updated.
+ * @param below const pointer to the row below.
+ * @param next pointer to the row receiving the next generation.
+ * @param begin size_t with the first word to update, at least 1.
+ * @param end size_t past the last word to update, at most words_per_row() - 1.
+ */
+typedef void (*PackedRowKernel)(const PackedBoard::Word *above,
+                                const PackedBoard::Word *row,
+                                const PackedBoard::Word *below,
+                                PackedBoard::Word *next, size_t begin,
+                                size_t end);
+
+/// Stepping kernel available for the packed board
+struct PackedKernel {
+  const char *name;      ///< Name of the instruction set used by the kernel
+  bool (*supported)();   ///< Whether the running CPU can execute the kernel
+  PackedRowKernel kernel; ///< Function updating the interior of a row
+};
+
+/**
+ * Lists the packed stepping kernels compiled in this binary for the selected
+ * rule.
+ *
+ * @return const reference to the kernels, ordered from the fastest to the
+ * portable scalar one, which is always the last and always supported.
+ */
+const std::vector<PackedKernel> &packed_kernels();
+
+/**
+ * Gets the kernel used by update_board on a PackedBoard.
+ *
+ * On the first call the fastest kernel supported by the CPU is selected.
+ *
+ * @return const reference to the selected kernel.
+ */
+const PackedKernel &packed_kernel();
+
+/**
+ * Selects the kernel used by update_board on a PackedBoard.
+ *
+ * @param name const std::string with the name of the kernel.
+ * @return bool true if the kernel exists and is supported by the CPU.
+ */
+bool select_packed_kernel(const std::string &name);
+
+/**
+ * Runs through a PackedBoard looking for a living cell
+ *
+ * @param board PackedBoard passed as a const reference
+ * @return bool return true if all cells are marked as dead.
+ */
+bool is_everybody_dead(const PackedBoard &board);
+
+/**
+ * Counts the living cells of a packed board
+ *
+ * @param board PackedBoard passed as a const reference
+ * @return size_t with the number of bits set in the board.
+ */
+size_t count_living_cells(const PackedBoard &board);
+
+/**
+ * Counts the living cells in a range of packed words
+ *
+ * @param first const pointer to the first word of the range.
+ * @param last const pointer past the last word of the range.
+ * @return size_t with the number of bits set in the range.
+ */
+size_t count_living_cells(const PackedBoard::Word *first,
+                          const PackedBoard::Word *last);
+
+/**
+ * Persistent pool of threads running the same task on every thread.
+ *
+ * The threads are created once and wait between tasks, so running a task
+ * only costs waking them up and waiting for all of them to finish.
+ */
+class ThreadPool {
+public:
+  /**
+   * Creates a pool with the given number of threads, counting the caller.
+   *
+   * @param threads size_t with the number of threads, at least 1.
+   */
+  explicit ThreadPool(size_t threads);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  /// Number of threads running each task, counting the caller
+  size_t size() const { return workers.size() + 1; }
+
+  /**
+   * Runs a task on every thread and waits until all of them are done.
+   *
+   * @param task const reference to the function called with the index of the
+   * thread, from 0 to size() - 1. The index 0 runs on the calling thread.
+   */
+  void run(const std::function<void(size_t)> &task);
+
+private:
+  void work(size_t index);
+
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable start;
+  std::condition_variable done;
+  const std::function<void(size_t)> *task = nullptr;
+  size_t generation = 0;
+  size_t pending = 0;
+  bool stopping = false;
+};
+
+/**
+ * Scheduler sharing a list of tiles between the threads of a pool.
+ *
+ * Each thread starts with a contiguous range of tiles and takes them from the
+ * front of its range. Once its range is empty, it steals tiles from the back
+ * of the ranges of the other threads, so no thread is idle while there is
+ * work left. A range is stored in a single atomic word, which makes taking
+ * and stealing a tile a compare-and-swap with no allocation.
+ */
+class TileScheduler {
+public:
+  /**
+   * Creates a scheduler for a number of threads.
+   *
+   * @param threads size_t with the number of threads sharing the tiles.
+   */
+  explicit TileScheduler(size_t threads);
+
+  /**
+   * Runs a task once for every tile and waits until all of them are done.
+   *
+   * @param pool ThreadPool pointer running the task, or nullptr to run all
+   * tiles on the calling thread.
+   * @param tiles size_t with the number of tiles, indexed from 0.
+   * @param task const reference to the function called with each tile index.
+   */
+  void run(ThreadPool *pool, size_t tiles,
+           const std::function<void(size_t)> &task);
+
+private:
+  /// Range [first, last) of tiles left to a thread, packed in one word
+  struct alignas(CACHE_LINE_SIZE) Queue {
+    std::atomic<std::uint64_t> range{0};
+  };
+
+  bool take(size_t thread, size_t &tile);
+  bool steal(size_t thread, size_t &tile);
+
+  std::vector<Queue> queues;
+  const std::function<void(size_t)> *task = nullptr;
+  std::function<void(size_t)> work;
+};
+
+/// Strategies to share the update of a board between threads
+enum class Schedule {
+  bands, ///< One band of rows per thread
+  tiles  ///< TILE_SIZE rows high tiles shared through a TileScheduler
+};
+
+/**
+ * Double-buffered universe of the game.
+ *
+ * Owns the grid of the current generation and a second grid of the same
+ * size where the next generation is computed. Both are swapped on each step,
+ * so no memory is allocated after construction. The grids are mapped with
+ * map_grid and, with a thread pool, each band is written first by the thread
+ * stepping it, which places its pages on the NUMA node of that thread.
+ *
+ * With Schedule::tiles the world keeps the list of tiles that changed in the
+ * last step. A tile that did not change and has no changed neighbour stays
+ * the same in the next generation, and since the next grid still holds the
+ * previous generation, which was equal as well, it is skipped altogether.
+ *
+ * The number of living cells is counted by update_board while it writes the
+ * next grid, per band or per tile, so population() costs nothing.
+ *
+ * Besides its grids, a world offers the interface shared by every engine,
+ * see engine.h: load, read, step, generation and population.
+ *
+ * @tparam Grid Board or PackedBoard, stepped by the matching update_board.
+ */
+template <typename Grid> class World {
+public:
+  /**
+   * Creates a world with two grids filled with dead cells.
+   *
+   * @param width size_t with the number of columns of the grids.
+   * @param height size_t with the number of rows of the grids.
+   * @param threads size_t with the number of threads used on each step.
+   * @param schedule Schedule used to share the board between the threads.
+   * @param huge_pages bool, true to map the grids on huge pages.
+   */
+  World(size_t width, size_t height, size_t threads = 1,
+        Schedule schedule = Schedule::bands, bool huge_pages = false)
+      : current(map_grid<Grid>(width, height, huge_pages, grid_pages)),
+        next(map_grid<Grid>(width, height, huge_pages, grid_pages)),
+        pool(threads > 1 ? new ThreadPool(threads) : nullptr),
+        band_population(threads, 0),
+        tile_columns((width + Grid::TILE_WIDTH - 1) / Grid::TILE_WIDTH),
+        tile_rows((height + TILE_SIZE - 1) / TILE_SIZE),
+        scheduler(schedule == Schedule::tiles ? new TileScheduler(threads)
+                                              : nullptr),
+        step_band([this](size_t band) {
+          const size_t bands = pool->size();
+          band_population[band] =
+              update_board(current, next, current.height() * band / bands,
+                           current.height() * (band + 1) / bands);
+        }),
+        step_tile([this](size_t n) { update_tile(active[n]); }) {
+    if (scheduler) {
+      changed.assign(tile_columns * tile_rows, false);
+      tile_population.assign(tile_columns * tile_rows, 0);
+      population_change.assign(tile_columns * tile_rows, 0);
+      marked.assign(tile_columns * tile_rows, false);
+      active.reserve(tile_columns * tile_rows);
+      next_active.reserve(tile_columns * tile_rows);
+      activate_all();
+    }
+    place_bands();
+  }
+
+  World(const World &) = delete;
+  World &operator=(const World &) = delete;
+
+  /// Grid with the current generation
+  const Grid &board() const { return current; }
+
+  /**
+   * Grid with the previous generation, once the world has stepped.
+   *
+   * Tiles skipped by the last step hold the same cells in both grids.
+   */
+  const Grid &previous_board() const { return next; }
+
+  /**
+   * Grid with the current generation, to be modified.
+   *
+   * All tiles are updated on the next step, as any of them may change.
+   */
+  Grid &edit_board() {
+    if (scheduler)
+      activate_all();
+    population_known = false;
+    return current;
+  }
+
+  /// Number of living cells in the current generation
+  size_t population() const {
+    return population_known ? living_cells : count_living_cells(current);
+  }
+
+  /// Number of generations since the world was created or loaded
+  std::uint64_t generation() const { return generations; }
+
+  /// Pages of both grids and the nodes they ended up on
+  MemoryPlacement placement() const {
+    MemoryPlacement grids =
+        memory_placement(current.row(0), grid_bytes(current), grid_pages);
+    grids.add(memory_placement(next.row(0), grid_bytes(next), grid_pages));
+    return grids;
+  }
+
+  /**
+   * Replaces the current grid by the cells of a board, at generation 0.
+   *
+   * @tparam Other Board or PackedBoard to be loaded.
+   * @param board Other passed as const reference, with the size of the world.
+   * @throws std::runtime_error if the board does not have the size of the
+   * world.
+   */
+  template <typename Other> void load(const Other &board) {
+    if (board.width() != current.width() || board.height() != current.height())
+      throw std::runtime_error("the board does not have the size of the world");
+    Grid &cells = edit_board();
+    if constexpr (std::is_same<Other, Grid>::value)
+      cells = board;
+    else if constexpr (std::is_same<Grid, PackedBoard>::value) {
+      const Grid converted = pack_board(board);
+      cells = converted;
+    } else {
+      const Grid converted = unpack_board(board);
+      cells = converted;
+    }
+    generations = 0;
+  }
+
+  /**
+   * Copies a region of the torus into a board, wrapping around its edges.
+   *
+   * @tparam Other Board or PackedBoard receiving the cells.
+   * @param board Other passed by reference, whose size is the size of the
+   * region.
+   * @param top int64_t with the row of the world copied to row 0.
+   * @param left int64_t with the column of the world copied to column 0.
+   */
+  template <typename Other>
+  void read(Other &board, std::int64_t top = 0, std::int64_t left = 0) const {
+    const std::int64_t height = current.height(), width = current.width();
+    if constexpr (std::is_same<Other, Grid>::value) {
+      if (top == 0 && left == 0 && std::int64_t(board.width()) == width &&
+          std::int64_t(board.height()) == height) {
+        board = current;
+        return;
+      }
+    }
+    const size_t first_row = (top % height + height) % height;
+    const size_t first_column = (left % width + width) % width;
+    for (size_t i = 0; i < board.height(); ++i) {
+      const size_t row = (first_row + i) % height;
+      for (size_t j = 0; j < board.width(); ++j)
+        board.set(i, j, current.get(row, (first_column + j) % width));
+    }
+  }
+
+  /// Advances the world by a number of generations, one by default
+  void step(std::uint64_t count = 1) {
+    for (; count > 0; --count)
+      step_once();
+  }
+
+private:
+  /**
+   * Has each thread of the pool write its band of both grids first, so that
+   * the pages of the band are placed on its node. With several nodes, the
+   * threads other than the caller are bound to them in turn.
+   */
+  void place_bands() {
+    if (!pool)
+      return;
+    const size_t bands = pool->size(), nodes = numa_nodes();
+    pool->run([&](size_t band) {
+      if (band > 0 && nodes > 1)
+        bind_to_node(band * nodes / bands);
+      const size_t first_row = current.height() * band / bands;
+      const size_t last_row = current.height() * (band + 1) / bands;
+      clear_region(current, first_row, last_row, 0, current.width());
+      clear_region(next, first_row, last_row, 0, next.width());
+    });
+  }
+
+  /// Advances the world by one generation
+  void step_once() {
+    if (scheduler) {
+      const bool all_tiles = !population_known;
+      PROFILE_COUNT("active_tiles", active.size());
+      scheduler->run(pool.get(), active.size(), step_tile);
+      if (all_tiles) {
+        living_cells = 0;
+        for (size_t cells : tile_population)
+          living_cells += cells;
+      } else {
+        for (size_t tile : active)
+          living_cells += population_change[tile];
+      }
+      activate_changed();
+    } else if (pool) {
+      pool->run(step_band);
+      living_cells = 0;
+      for (size_t cells : band_population)
+        living_cells += cells;
+    } else {
+      living_cells = update_board(current, next);
+    }
+    population_known = true;
+    generations++;
+    std::swap(current, next);
+  }
+
+  /// Updates a tile, or just clears it when it is surrounded by dead cells
+  void update_tile(size_t tile) {
+    const size_t first_row = tile / tile_columns * TILE_SIZE;
+    const size_t first_column = tile % tile_columns * Grid::TILE_WIDTH;
+    const size_t last_row = std::min(first_row + TILE_SIZE, current.height());
+    const size_t last_column =
+        std::min(first_column + Grid::TILE_WIDTH, current.width());
+
+    size_t cells = 0;
+    if (is_region_dead(current, first_row, last_row, first_column,
+                       last_column))
+      clear_region(next, first_row, last_row, first_column, last_column);
+    else
+      cells = update_board(current, next, first_row, last_row, first_column,
+                           last_column);
+    population_change[tile] = cells - tile_population[tile];
+    tile_population[tile] = cells;
+    changed[tile] = !is_region_equal(current, next, first_row, last_row,
+                                     first_column, last_column);
+  }
+
+  /// Marks every tile to be updated on the next step
+  void activate_all() {
+    active.clear();
+    for (size_t tile = 0; tile < tile_columns * tile_rows; ++tile)
+      active.push_back(tile);
+  }
+
+  /// Replaces the active tiles by the ones next to a tile that changed
+  void activate_changed() {
+    next_active.clear();
+    for (size_t tile : active) {
+      if (!changed[tile])
+        continue;
+      const size_t row = tile / tile_columns, column = tile % tile_columns;
+      for (size_t i = 0; i < 3; ++i) {
+        for (size_t j = 0; j < 3; ++j) {
+          const size_t neighbour =
+              (row + tile_rows - 1 + i) % tile_rows * tile_columns +
+              (column + tile_columns - 1 + j) % tile_columns;
+          if (!marked[neighbour]) {
+            marked[neighbour] = true;
+            next_active.push_back(neighbour);
+          }
+        }
+      }
+    }
+    for (size_t tile : next_active)
+      marked[tile] = false;
+    std::swap(active, next_active);
+  }
+
+  PageKind grid_pages = PageKind::standard; ///< Pages of both grids
+  Grid current;
+  Grid next;
+  std::unique_ptr<ThreadPool> pool;
+  size_t living_cells = 0;
+  bool population_known = false; ///< Whether living_cells is up to date
+  std::uint64_t generations = 0;
+  std::vector<size_t> band_population;
+  size_t tile_columns;
+  size_t tile_rows;
+  std::unique_ptr<TileScheduler> scheduler;
+  std::vector<std::uint8_t> changed; ///< Tiles that changed in the last step
+  std::vector<std::uint8_t> marked;  ///< Scratch flags used by activate_changed
+  std::vector<size_t> tile_population; ///< Living cells of each tile
+  /// Change of the living cells of each tile in the last step, modulo 2^N
+  std::vector<size_t> population_change;
+  std::vector<size_t> active;        ///< Tiles to be updated on the next step
+  std::vector<size_t> next_active;
+  std::function<void(size_t)> step_band;
+  std::function<void(size_t)> step_tile;
+};
+
+/**
+ * Incremental renderer of boards on an ANSI terminal.
+ *
+ * Each frame is assembled in a single buffer and sent with one write(). The
+ * first frame clears the screen, the next ones only move the cursor to the
+ * cells that changed since the previous frame and redraw them.
+ */
+class TerminalRenderer {
+public:
+  /**
+   * Creates a renderer writing to a file descriptor.
+   *
+   * @param fd int with the file descriptor of the terminal.
+   */
+  explicit TerminalRenderer(int fd = STDOUT_FILENO) : fd(fd) {}
+
+  /**
+   * Draws a board followed by a status line.
+   *
+   * Uses the ALIVE_SYMBOL and the DEAD_SYMBOL to represents the cells state,
+   * and leaves the cursor on the line below the status.
+   *
+   * @tparam Grid Board or PackedBoard to be drawn.
+   * @param board Grid passed as const reference to be drawn.
+   * @param status const std::string printed below the board.
+   */
+  template <typename Grid>
+  void render(const Grid &board, const std::string &status) {
+    PROFILE_SCOPE("render");
+    const bool redraw = !drawn || board.width() != previous.width() ||
+                        board.height() != previous.height();
+    frame.clear();
+
+    if (redraw) {
+      previous = Board(board.width(), board.height());
+      frame += "\x1b[H\x1b[2J";
+    }
+    for (size_t i = 0; i < board.height(); ++i) {
+      bool in_run = false;
+      for (size_t j = 0; j < board.width(); ++j) {
+        const Cell cell = board.get(i, j);
+        if (!redraw && cell == previous(i, j)) {
+          in_run = false;
+          continue;
+        }
+        if (!redraw && !in_run)
+          move_cursor(i, j * ALIVE_SYMBOL.size());
+        in_run = true;
+        frame += cell == Cell::alive ? ALIVE_SYMBOL : DEAD_SYMBOL;
+        previous(i, j) = cell;
+      }
+      if (redraw)
+        frame += '\n';
+    }
+
+    move_cursor(board.height(), 0);
+    frame += status;
+    frame += "\x1b[K\n";
+    drawn = true;
+    flush();
+  }
+
+private:
+  /// Appends the sequence moving the cursor to a 0-based line and column
+  void move_cursor(size_t line, size_t column);
+  /// Writes the frame buffer to the terminal
+  void flush();
+
+  int fd;
+  bool drawn = false;
+  Board previous; ///< Cells shown on the terminal
+  std::string frame;
+};
+
+#endif // GAME_OF_LIFE_H
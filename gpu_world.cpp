@@ -0,0 +1,57 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file implements the GPU engine declared in gpu_world.h when it is
+ * compiled out: the CUDA engine of gpu_world.cu is only built with make
+ * GPU=1, and the world here can never be created.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#include "gpu_world.h"
+
+#include <stdexcept>
+
+/*
+    Implementations
+*/
+
+#ifndef GOL_GPU
+
+struct GpuWorld::Device {};
+
+GpuWorld::GpuWorld(size_t width, size_t height)
+    : columns(width), rows(height) {
+  throw std::runtime_error("the GPU engine needs a build with make GPU=1");
+}
+
+GpuWorld::~GpuWorld() = default;
+
+std::string GpuWorld::device_name() const { return "none"; }
+
+void GpuWorld::load(const PackedBoard &) {}
+
+void GpuWorld::read(PackedBoard &board) const {
+  board = PackedBoard(columns, rows);
+}
+
+void GpuWorld::step(std::uint64_t count) { generations += count; }
+
+std::uint64_t GpuWorld::population() const { return 0; }
+
+#endif // GOL_GPU
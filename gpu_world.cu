@@ -0,0 +1,237 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file implements the GPU engine declared in gpu_world.h with CUDA. It
+ * is compiled by nvcc with make GPU=1 and replaces the stub of gpu_world.cpp.
+ *
+ * Each thread updates one word of 64 cells, adding its eight neighbouring
+ * words bit by bit like the packed kernels of the CPU, and the warps add the
+ * living cells they produced to the population of the generation.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#include "gpu_world.h"
+
+#include <cuda_runtime.h>
+#include <stdexcept>
+
+/*
+    Implementations
+*/
+
+typedef PackedBoard::Word Word;
+
+/// Threads of a block along the words and the rows; a warp covers a row
+static const dim3 BLOCK(32, 8);
+
+/// Throws the error of a CUDA call, if any
+static void check(cudaError_t error, const char *what) {
+  if (error != cudaSuccess)
+    throw std::runtime_error(std::string("GPU: cannot ") + what + ": " +
+                             cudaGetErrorString(error));
+}
+
+struct GpuWorld::Device {
+  Word *current = nullptr, *next = nullptr;
+  unsigned long long *population = nullptr;
+  cudaStream_t stream = nullptr;
+  size_t words_per_row = 0;
+  Word last_mask = 0;
+  Rule rule;
+  cudaDeviceProp properties;
+
+  ~Device() {
+    cudaFree(current);
+    cudaFree(next);
+    cudaFree(population);
+    if (stream)
+      cudaStreamDestroy(stream);
+  }
+
+  size_t bytes(size_t rows) const { return rows * words_per_row * sizeof(Word); }
+
+  dim3 grid(size_t rows) const {
+    return dim3((words_per_row + BLOCK.x - 1) / BLOCK.x,
+                (rows + BLOCK.y - 1) / BLOCK.y);
+  }
+};
+
+/// Adds three words bit by bit into a sum and a carry
+__device__ static void add(Word a, Word b, Word c, Word &sum, Word &carry) {
+  const Word half = a ^ b;
+  sum = half ^ c;
+  carry = (a & b) | (half & c);
+}
+
+/// Neighbours on the west of the cells of word k, wrapping around the torus
+__device__ static Word west(const Word *row, size_t k, size_t words,
+                            size_t width) {
+  const Word carry =
+      k > 0 ? row[k - 1] >> 63
+            : row[(width - 1) / 64] >> ((width - 1) % 64) & 1;
+  return row[k] << 1 | carry;
+}
+
+/// Neighbours on the east of the cells of word k, wrapping around the torus
+__device__ static Word east(const Word *row, size_t k, size_t words,
+                            size_t width) {
+  const Word carry =
+      k + 1 < words ? row[k + 1] << 63 : (row[0] & 1) << ((width - 1) % 64);
+  return row[k] >> 1 | carry;
+}
+
+/// Adds the living cells of the warp to the population of the generation
+__device__ static void count(Word cells, unsigned long long *population) {
+  unsigned long long living = __popcll(cells);
+  for (int offset = 16; offset > 0; offset /= 2)
+    living += __shfl_down_sync(0xffffffff, living, offset);
+  if (threadIdx.x == 0 && living)
+    atomicAdd(population, living);
+}
+
+__global__ static void step_kernel(const Word *current, Word *next,
+                                   size_t rows, size_t words, size_t width,
+                                   Word last_mask, unsigned birth,
+                                   unsigned survival,
+                                   unsigned long long *population) {
+  const size_t k = blockIdx.x * blockDim.x + threadIdx.x;
+  const size_t i = blockIdx.y * blockDim.y + threadIdx.y;
+  Word cells = 0;
+  // Threads past the board still take part in the reduction of their warp.
+  if (i < rows && k < words) {
+    const Word *above = current + (i == 0 ? rows - 1 : i - 1) * words;
+    const Word *row = current + i * words;
+    const Word *below = current + (i + 1 == rows ? 0 : i + 1) * words;
+
+    Word sum_a, carry_a, sum_b, carry_b, sum_c, carry_c;
+    add(above[k], west(above, k, words, width), east(above, k, words, width),
+        sum_a, carry_a);
+    add(below[k], west(below, k, words, width), east(below, k, words, width),
+        sum_b, carry_b);
+    add(west(row, k, words, width), east(row, k, words, width), 0, sum_c,
+        carry_c);
+    Word ones, carry_ones, twos, fours;
+    add(sum_a, sum_b, sum_c, ones, carry_ones);
+    add(carry_a, carry_b, carry_c, twos, fours);
+    const Word bits[4] = {ones, twos ^ carry_ones,
+                          fours ^ (twos & carry_ones),
+                          fours & twos & carry_ones};
+
+    const Word alive = row[k];
+    for (unsigned n = 0; n <= 8; ++n) {
+      if (!((birth | survival) >> n & 1))
+        continue;
+      Word neighbours = ~Word(0);
+      for (unsigned b = 0; b < 4; ++b)
+        neighbours &= n >> b & 1 ? bits[b] : ~bits[b];
+      if (birth >> n & 1)
+        cells |= neighbours & ~alive;
+      if (survival >> n & 1)
+        cells |= neighbours & alive;
+    }
+    if (k + 1 == words)
+      cells &= last_mask;
+    next[i * words + k] = cells;
+  }
+  count(cells, population);
+}
+
+__global__ static void count_kernel(const Word *current, size_t rows,
+                                    size_t words,
+                                    unsigned long long *population) {
+  const size_t k = blockIdx.x * blockDim.x + threadIdx.x;
+  const size_t i = blockIdx.y * blockDim.y + threadIdx.y;
+  count(i < rows && k < words ? current[i * words + k] : 0, population);
+}
+
+GpuWorld::GpuWorld(size_t width, size_t height)
+    : columns(width), rows(height), device(new Device) {
+  check(cudaGetDeviceProperties(&device->properties, 0), "find a device");
+  const PackedBoard shape(width, std::min<size_t>(height, 1));
+  device->words_per_row = shape.words_per_row();
+  device->last_mask = shape.last_word_mask();
+  device->rule = selected_rule();
+  check(cudaStreamCreate(&device->stream), "create a stream");
+  check(cudaMalloc(&device->current, device->bytes(rows)), "allocate the board");
+  check(cudaMalloc(&device->next, device->bytes(rows)), "allocate the board");
+  check(cudaMalloc(&device->population, sizeof(unsigned long long)),
+        "allocate the population");
+  check(cudaMemsetAsync(device->current, 0, device->bytes(rows),
+                        device->stream),
+        "clear the board");
+  check(cudaMemsetAsync(device->population, 0, sizeof(unsigned long long),
+                        device->stream),
+        "clear the population");
+}
+
+GpuWorld::~GpuWorld() = default;
+
+std::string GpuWorld::device_name() const { return device->properties.name; }
+
+void GpuWorld::load(const PackedBoard &board) {
+  if (board.width() != columns || board.height() != rows)
+    throw std::runtime_error("GPU: the board does not have the size of the "
+                             "world");
+  check(cudaMemcpyAsync(device->current, board.row(0), device->bytes(rows),
+                        cudaMemcpyHostToDevice, device->stream),
+        "copy the board");
+  check(cudaMemsetAsync(device->population, 0, sizeof(unsigned long long),
+                        device->stream),
+        "clear the population");
+  count_kernel<<<device->grid(rows), BLOCK, 0, device->stream>>>(
+      device->current, rows, device->words_per_row, device->population);
+  check(cudaGetLastError(), "count the cells");
+  // The board may be gone once load returns.
+  check(cudaStreamSynchronize(device->stream), "copy the board");
+  generations = 0;
+}
+
+void GpuWorld::read(PackedBoard &board) const {
+  board = PackedBoard(columns, rows);
+  check(cudaMemcpyAsync(board.row(0), device->current, device->bytes(rows),
+                        cudaMemcpyDeviceToHost, device->stream),
+        "read the board");
+  check(cudaStreamSynchronize(device->stream), "read the board");
+}
+
+void GpuWorld::step(std::uint64_t count) {
+  PROFILE_SCOPE("gpu_step");
+  for (std::uint64_t g = 0; g < count; ++g) {
+    check(cudaMemsetAsync(device->population, 0, sizeof(unsigned long long),
+                          device->stream),
+          "clear the population");
+    step_kernel<<<device->grid(rows), BLOCK, 0, device->stream>>>(
+        device->current, device->next, rows, device->words_per_row, columns,
+        device->last_mask, device->rule.birth, device->rule.survival,
+        device->population);
+    check(cudaGetLastError(), "step the board");
+    std::swap(device->current, device->next);
+  }
+  generations += count;
+}
+
+std::uint64_t GpuWorld::population() const {
+  PROFILE_SCOPE("gpu_population");
+  unsigned long long population = 0;
+  check(cudaMemcpyAsync(&population, device->population, sizeof(population),
+                        cudaMemcpyDeviceToHost, device->stream),
+        "read the population");
+  check(cudaStreamSynchronize(device->stream), "read the population");
+  return population;
+}
@@ -0,0 +1,117 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file declares the GPU engine, stepping a packed torus kept resident in
+ * the memory of a CUDA device. The cells only cross the bus when they are
+ * loaded, read back for rendering or saved; the population is reduced on the
+ * device while stepping, so checking for a dead board copies a single word.
+ *
+ * The engine is only compiled with GOL_GPU defined, by building with make
+ * GPU=1, which needs nvcc. Otherwise creating a GpuWorld throws and
+ * GPU_ENABLED tells the engine is missing beforehand.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#ifndef GPU_WORLD_H
+#define GPU_WORLD_H
+
+#include "game_of_life.h"
+
+#include <memory>
+#include <string>
+
+#ifdef GOL_GPU
+constexpr bool GPU_ENABLED = true;
+#else
+constexpr bool GPU_ENABLED = false;
+#endif
+
+/**
+ * Packed torus stepped on a GPU.
+ *
+ * It offers the interface of the engines on a plane, so the game drives it
+ * the same way: the board is loaded once, stepped any number of generations
+ * and read back only when it is needed on the host.
+ */
+class GpuWorld {
+public:
+  /**
+   * Creates a dead torus in the memory of the first CUDA device, following
+   * the rule selected when it is created.
+   *
+   * @param width size_t with the number of columns.
+   * @param height size_t with the number of rows.
+   * @throws std::runtime_error if there is no usable device or the engine
+   * is compiled out.
+   */
+  GpuWorld(size_t width, size_t height);
+  ~GpuWorld();
+
+  GpuWorld(const GpuWorld &) = delete;
+  GpuWorld &operator=(const GpuWorld &) = delete;
+
+  size_t width() const { return columns; }
+  size_t height() const { return rows; }
+
+  /// Name of the device, for the reports
+  std::string device_name() const;
+
+  /**
+   * Copies the cells of a board to the device, at generation 0.
+   *
+   * @param board PackedBoard with the size of the world.
+   */
+  void load(const PackedBoard &board);
+  void load(const Board &board) { load(pack_board(board)); }
+
+  /**
+   * Copies the current cells back from the device.
+   *
+   * @param board PackedBoard resized to the size of the world.
+   */
+  void read(PackedBoard &board) const;
+  void read(Board &board) const {
+    PackedBoard packed;
+    read(packed);
+    board = unpack_board(packed);
+  }
+
+  /**
+   * Advances the world by any number of generations, queued on the device
+   * without waiting for them.
+   *
+   * @param generations uint64_t with the number of generations.
+   */
+  void step(std::uint64_t generations = 1);
+
+  /// Number of generations since the world was loaded
+  std::uint64_t generation() const { return generations; }
+
+  /// Number of living cells, counted on the device
+  std::uint64_t population() const;
+
+private:
+  struct Device; ///< Buffers and stream of the device
+
+  size_t columns, rows;
+  std::uint64_t generations = 0;
+  std::unique_ptr<Device> device;
+};
+
+#endif // GPU_WORLD_H
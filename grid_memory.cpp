@@ -0,0 +1,290 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file implements the memory of the grids declared in grid_memory.h,
+ * with the system calls of Linux and no NUMA library.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#include "grid_memory.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <new>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+
+/*
+    Implementations
+*/
+
+static const std::size_t HUGE_2M = std::size_t(1) << 21;
+static const std::size_t HUGE_1G = std::size_t(1) << 30;
+
+/// Largest number of pages whose node is asked to the kernel
+static const std::size_t PLACEMENT_SAMPLES = 4096;
+
+const char *page_kind_string(PageKind pages) {
+  static const char *const NAMES[] = {"standard", "transparent", "2M", "1G"};
+  return NAMES[static_cast<int>(pages)];
+}
+
+/// Block mapped with mmap, unmapped with its length once released
+static std::shared_ptr<void> mapped_block(void *address, std::size_t length) {
+  return std::shared_ptr<void>(
+      address, [length](void *block) { munmap(block, length); });
+}
+
+/// Maps anonymous memory with some flags, or returns null
+static void *map_anonymous(std::size_t length, int flags) {
+  void *address = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+  return address == MAP_FAILED ? nullptr : address;
+}
+
+/// Rounds a size up to a multiple of a power of 2
+static std::size_t round_up(std::size_t bytes, std::size_t multiple) {
+  return (bytes + multiple - 1) & ~(multiple - 1);
+}
+
+GridMemory map_grid_memory(std::size_t bytes, bool huge_pages) {
+  GridMemory memory;
+  memory.bytes = bytes;
+  bytes = std::max<std::size_t>(bytes, 1);
+
+  if (huge_pages) {
+    struct Attempt {
+      std::size_t page;
+      int flags;
+      PageKind pages;
+    };
+    const Attempt attempts[] = {
+        {HUGE_1G, MAP_HUGETLB | MAP_HUGE_1GB, PageKind::huge_1g},
+        {HUGE_2M, MAP_HUGETLB | MAP_HUGE_2MB, PageKind::huge_2m}};
+    for (const Attempt &attempt : attempts) {
+      // A 1 GiB page is not worth it for a grid a fraction of its size.
+      if (attempt.page == HUGE_1G && bytes < HUGE_1G)
+        continue;
+      const std::size_t length = round_up(bytes, attempt.page);
+      if (void *address = map_anonymous(length, attempt.flags)) {
+        memory.block = mapped_block(address, length);
+        memory.pages = attempt.pages;
+        return memory;
+      }
+    }
+
+    // Transparent huge pages need the block aligned to 2 MiB: a larger block
+    // is mapped and the ends around the aligned part are given back.
+    const std::size_t length = round_up(bytes, HUGE_2M);
+    if (void *address = map_anonymous(length + HUGE_2M, 0)) {
+      const std::uintptr_t start = reinterpret_cast<std::uintptr_t>(address);
+      const std::uintptr_t aligned = round_up(start, HUGE_2M);
+      if (aligned > start)
+        munmap(address, aligned - start);
+      if (HUGE_2M > aligned - start)
+        munmap(reinterpret_cast<void *>(aligned + length),
+               HUGE_2M - (aligned - start));
+      madvise(reinterpret_cast<void *>(aligned), length, MADV_HUGEPAGE);
+      memory.block = mapped_block(reinterpret_cast<void *>(aligned), length);
+      memory.pages = PageKind::transparent;
+      return memory;
+    }
+  }
+
+  void *address = map_anonymous(bytes, 0);
+  if (!address)
+    throw std::bad_alloc();
+  memory.block = mapped_block(address, bytes);
+  memory.pages = PageKind::standard;
+  return memory;
+}
+
+/// Path of the CPUs of a node in sysfs
+static std::string node_cpulist(std::size_t node) {
+  return "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist";
+}
+
+std::size_t numa_nodes() {
+  static const std::size_t nodes = [] {
+    std::size_t count = 0;
+    while (std::ifstream(node_cpulist(count)).good())
+      count++;
+    return std::max<std::size_t>(count, 1);
+  }();
+  return nodes;
+}
+
+bool bind_to_node(std::size_t node) {
+  std::ifstream file(node_cpulist(node));
+  std::string list;
+  if (!std::getline(file, list))
+    return false;
+
+  // The list is made of ranges such as 0-7,16-23 and single CPUs.
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  bool any = false;
+  for (std::size_t start = 0; start < list.size();) {
+    std::size_t end = list.find(',', start);
+    if (end == std::string::npos)
+      end = list.size();
+    unsigned first, last;
+    const int fields =
+        std::sscanf(list.substr(start, end - start).c_str(), "%u-%u", &first,
+                    &last);
+    if (fields >= 1) {
+      if (fields == 1)
+        last = first;
+      for (unsigned cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu) {
+        CPU_SET(cpu, &cpus);
+        any = true;
+      }
+    }
+    start = end + 1;
+  }
+  return any &&
+         pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+}
+
+void MemoryPlacement::add(const MemoryPlacement &other) {
+  bytes += other.bytes;
+  huge_bytes += other.huge_bytes;
+  unplaced_bytes += other.unplaced_bytes;
+  if (node_bytes.size() < other.node_bytes.size())
+    node_bytes.resize(other.node_bytes.size(), 0);
+  for (std::size_t node = 0; node < other.node_bytes.size(); ++node)
+    node_bytes[node] += other.node_bytes[node];
+}
+
+/**
+ * Bytes of transparent huge pages in the mappings overlapping some memory.
+ * A mapping merged with its neighbours may count a few of theirs too, so the
+ * result is capped to the size of the memory.
+ */
+static std::size_t transparent_huge_bytes(std::uintptr_t start,
+                                          std::size_t bytes) {
+  std::ifstream smaps("/proc/self/smaps");
+  std::string line;
+  bool overlaps = false;
+  std::size_t huge = 0;
+  while (std::getline(smaps, line)) {
+    unsigned long first, last;
+    unsigned long kilobytes;
+    if (std::sscanf(line.c_str(), "%lx-%lx ", &first, &last) == 2 &&
+        line.find(':') > line.find(' ')) {
+      overlaps = first < start + bytes && last > start;
+    } else if (overlaps && std::sscanf(line.c_str(), "AnonHugePages: %lu kB",
+                                       &kilobytes) == 1) {
+      huge += std::size_t(kilobytes) << 10;
+    }
+  }
+  return std::min(huge, bytes);
+}
+
+MemoryPlacement memory_placement(const void *memory, std::size_t bytes,
+                                 PageKind pages) {
+  MemoryPlacement placement;
+  placement.pages = pages;
+  placement.bytes = bytes;
+  if (!memory || bytes == 0)
+    return placement;
+  const std::uintptr_t start = reinterpret_cast<std::uintptr_t>(memory);
+
+  if (pages == PageKind::huge_2m || pages == PageKind::huge_1g)
+    placement.huge_bytes = bytes;
+  else
+    placement.huge_bytes = transparent_huge_bytes(start, bytes);
+
+  // move_pages with no target nodes only reports the node of each page.
+  const std::size_t page = sysconf(_SC_PAGESIZE);
+  const std::uintptr_t first_page = start & ~(page - 1);
+  const std::size_t page_count = (start + bytes - first_page + page - 1) / page;
+  const std::size_t samples = std::min(page_count, PLACEMENT_SAMPLES);
+  std::vector<void *> addresses(samples);
+  for (std::size_t s = 0; s < samples; ++s)
+    addresses[s] =
+        reinterpret_cast<void *>(first_page + s * page_count / samples * page);
+  std::vector<int> status(samples, -1);
+  if (syscall(SYS_move_pages, 0, samples, addresses.data(), nullptr,
+              status.data(), 0) != 0) {
+    placement.unplaced_bytes = bytes;
+    return placement;
+  }
+  for (std::size_t s = 0; s < samples; ++s) {
+    // The samples share the bytes, the last one taking the remainder.
+    const std::size_t share =
+        bytes / samples + (s + 1 == samples ? bytes % samples : 0);
+    if (status[s] < 0) {
+      placement.unplaced_bytes += share;
+      continue;
+    }
+    if (placement.node_bytes.size() <= std::size_t(status[s]))
+      placement.node_bytes.resize(status[s] + 1, 0);
+    placement.node_bytes[status[s]] += share;
+  }
+  return placement;
+}
+
+/// Size in MiB, or KiB below 1 MiB, with one decimal, for the text reports
+static std::string mebibytes(std::size_t bytes) {
+  char text[32];
+  if (bytes < (std::size_t(1) << 20))
+    std::snprintf(text, sizeof(text), "%.1f KiB", bytes / 1024.0);
+  else
+    std::snprintf(text, sizeof(text), "%.1f MiB", bytes / 1048576.0);
+  return text;
+}
+
+std::string placement_report(const MemoryPlacement &placement, bool json) {
+  std::string report;
+  if (json) {
+    report = ", \"pages\": \"" + std::string(page_kind_string(placement.pages)) +
+             "\", \"grid_bytes\": " + std::to_string(placement.bytes) +
+             ", \"huge_page_bytes\": " + std::to_string(placement.huge_bytes) +
+             ", \"node_bytes\": [";
+    for (std::size_t node = 0; node < placement.node_bytes.size(); ++node)
+      report += (node ? ", " : "") + std::to_string(placement.node_bytes[node]);
+    return report + "], \"unplaced_bytes\": " +
+           std::to_string(placement.unplaced_bytes);
+  }
+  report = mebibytes(placement.bytes) + " of grids on " +
+           page_kind_string(placement.pages) + " pages, " +
+           mebibytes(placement.huge_bytes) + " in huge pages";
+  for (std::size_t node = 0; node < placement.node_bytes.size(); ++node)
+    report += ", " + mebibytes(placement.node_bytes[node]) + " on node " +
+              std::to_string(node);
+  if (placement.unplaced_bytes)
+    report += ", " + mebibytes(placement.unplaced_bytes) + " not placed";
+  return report;
+}
@@ -0,0 +1,115 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file declares the memory of the grids of a world, mapped apart from
+ * the heap so that its pages can be huge and placed on the NUMA nodes of the
+ * threads stepping them.
+ *
+ * The memory is mapped zeroed and left untouched: Linux places each page on
+ * the node of the thread that first writes it. A world with a thread pool
+ * has every thread clear its own band first, after binding the threads of
+ * the pool to the nodes in turn, so each band ends up local to the thread
+ * updating it. memory_placement then tells where the pages actually are.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#ifndef GRID_MEMORY_H
+#define GRID_MEMORY_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// Pages backing the memory of a grid
+enum class PageKind {
+  standard,    ///< Base pages of the machine, usually 4 KiB
+  transparent, ///< Base pages the kernel may merge into 2 MiB huge pages
+  huge_2m,     ///< 2 MiB pages reserved in the hugetlb pool
+  huge_1g      ///< 1 GiB pages reserved in the hugetlb pool
+};
+
+/// Name of a kind of pages, for the reports
+const char *page_kind_string(PageKind pages);
+
+/// Zeroed memory of a grid, aligned to a page and not touched yet
+struct GridMemory {
+  std::shared_ptr<void> block; ///< Unmapped once the last owner is gone
+  std::size_t bytes = 0;
+  PageKind pages = PageKind::standard;
+};
+
+/**
+ * Maps the memory of a grid.
+ *
+ * With huge pages it tries 1 GiB pages for blocks of at least 1 GiB, then
+ * 2 MiB pages, both only available once reserved by the administrator, and
+ * falls back to transparent huge pages on a block aligned to 2 MiB.
+ *
+ * @param bytes size_t with the size of the grid.
+ * @param huge_pages bool, true to ask for huge pages.
+ * @return GridMemory with the kind of pages obtained.
+ * @throws std::bad_alloc if no memory can be mapped.
+ */
+GridMemory map_grid_memory(std::size_t bytes, bool huge_pages);
+
+/// Number of NUMA nodes of the machine, 1 if it cannot tell
+std::size_t numa_nodes();
+
+/**
+ * Restricts the calling thread to the CPUs of a NUMA node.
+ *
+ * @param node size_t with the index of the node.
+ * @return bool false if the CPUs of the node are unknown.
+ */
+bool bind_to_node(std::size_t node);
+
+/// Where the pages of some memory are
+struct MemoryPlacement {
+  PageKind pages = PageKind::standard;
+  std::size_t bytes = 0;      ///< Bytes examined
+  std::size_t huge_bytes = 0; ///< Bytes backed by huge pages
+  /// Bytes on each node, estimated from a sample of the pages
+  std::vector<std::size_t> node_bytes;
+  std::size_t unplaced_bytes = 0; ///< Bytes not resident or of unknown node
+
+  /// Adds the placement of more memory, of the same kind of pages
+  void add(const MemoryPlacement &other);
+};
+
+/**
+ * Finds where the pages of some memory are: the huge pages backing it, from
+ * /proc/self/smaps, and the node of each page, from move_pages.
+ *
+ * @param memory const void pointer to the first byte.
+ * @param bytes size_t with the size of the memory.
+ * @param pages PageKind requested for the memory.
+ */
+MemoryPlacement memory_placement(const void *memory, std::size_t bytes,
+                                 PageKind pages);
+
+/**
+ * Describes a placement for the headless reports.
+ *
+ * @param json bool, true for the fields of a JSON object, each preceded by a
+ * comma, false for a line of text.
+ */
+std::string placement_report(const MemoryPlacement &placement, bool json);
+
+#endif // GRID_MEMORY_H
@@ -0,0 +1,360 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file implements the HashLife engine declared in hashlife.h.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#include "hashlife.h"
+
+/*
+    Implementations
+*/
+
+/// Number of nodes allocated at once
+const size_t NODE_BLOCK_SIZE = 1 << 16;
+
+struct HashLife::NodeBlock {
+  Node nodes[NODE_BLOCK_SIZE];
+};
+
+HashLife::HashLife(size_t memory_limit)
+    : rule(selected_rule()), memory_limit(memory_limit) {
+  for (Cell cell : {Cell::dead, Cell::alive}) {
+    leaves[cell == Cell::alive].reset(new Node);
+    leaves[cell == Cell::alive]->population = cell == Cell::alive;
+  }
+  buckets.assign(NODE_BLOCK_SIZE, nullptr);
+  clear();
+}
+
+HashLife::~HashLife() = default;
+
+HashLife::Node *HashLife::leaf(Cell cell) const {
+  return leaves[cell == Cell::alive].get();
+}
+
+HashLife::Node *HashLife::empty(unsigned level) {
+  if (empties.empty())
+    empties.push_back(leaf(Cell::dead));
+  while (empties.size() <= level) {
+    Node *below = empties.back();
+    empties.push_back(node(below, below, below, below));
+  }
+  return empties[level];
+}
+
+/// Hash of the four children of a node
+static size_t hash_children(const void *nw, const void *ne, const void *sw,
+                            const void *se) {
+  size_t hash = reinterpret_cast<std::uintptr_t>(nw);
+  hash = hash * 0x9E3779B97F4A7C15ull + reinterpret_cast<std::uintptr_t>(ne);
+  hash = hash * 0x9E3779B97F4A7C15ull + reinterpret_cast<std::uintptr_t>(sw);
+  hash = hash * 0x9E3779B97F4A7C15ull + reinterpret_cast<std::uintptr_t>(se);
+  return hash ^ (hash >> 29);
+}
+
+HashLife::Node *HashLife::node(Node *nw, Node *ne, Node *sw, Node *se) {
+  Node *&bucket =
+      buckets[hash_children(nw, ne, sw, se) & (buckets.size() - 1)];
+  for (Node *current = bucket; current; current = current->next) {
+    if (current->nw == nw && current->ne == ne && current->sw == sw &&
+        current->se == se)
+      return current;
+  }
+
+  Node *created = allocate();
+  created->nw = nw;
+  created->ne = ne;
+  created->sw = sw;
+  created->se = se;
+  created->level = nw->level + 1;
+  created->population =
+      nw->population + ne->population + sw->population + se->population;
+  created->next = bucket;
+  bucket = created;
+
+  if (nodes_in_use > buckets.size())
+    rehash(buckets.size() * 2);
+  return created;
+}
+
+HashLife::Node *HashLife::allocate() {
+  if (!free_nodes) {
+    blocks.emplace_back(new NodeBlock);
+    for (Node &free_node : blocks.back()->nodes) {
+      free_node.next = free_nodes;
+      free_nodes = &free_node;
+    }
+  }
+  Node *allocated = free_nodes;
+  free_nodes = allocated->next;
+  *allocated = Node();
+  nodes_in_use++;
+  return allocated;
+}
+
+void HashLife::rehash(size_t size) {
+  std::vector<Node *> old_buckets(size, nullptr);
+  old_buckets.swap(buckets);
+  for (Node *bucket : old_buckets) {
+    while (bucket) {
+      Node *next = bucket->next;
+      Node *&new_bucket = buckets[hash_children(bucket->nw, bucket->ne,
+                                                bucket->sw, bucket->se) &
+                                  (buckets.size() - 1)];
+      bucket->next = new_bucket;
+      new_bucket = bucket;
+      bucket = next;
+    }
+  }
+}
+
+void HashLife::clear() {
+  root_level = 3;
+  root = empty(root_level);
+  root_top = 0;
+  root_left = 0;
+  generations = 0;
+}
+
+void HashLife::set(std::int64_t row, std::int64_t column, Cell cell) {
+  while (row < root_top || column < root_left ||
+         row - root_top >= std::int64_t(1) << root_level ||
+         column - root_left >= std::int64_t(1) << root_level)
+    root = expand(root);
+  root = set_node(root, root_level, row - root_top, column - root_left, cell);
+}
+
+HashLife::Node *HashLife::set_node(Node *current, unsigned level,
+                                   std::int64_t row, std::int64_t column,
+                                   Cell cell) {
+  if (level == 0)
+    return leaf(cell);
+
+  const std::int64_t half = std::int64_t(1) << (level - 1);
+  Node *nw = current->nw, *ne = current->ne, *sw = current->sw,
+       *se = current->se;
+  if (row < half && column < half)
+    nw = set_node(nw, level - 1, row, column, cell);
+  else if (row < half)
+    ne = set_node(ne, level - 1, row, column - half, cell);
+  else if (column < half)
+    sw = set_node(sw, level - 1, row - half, column, cell);
+  else
+    se = set_node(se, level - 1, row - half, column - half, cell);
+  return node(nw, ne, sw, se);
+}
+
+Cell HashLife::get(std::int64_t row, std::int64_t column) const {
+  row -= root_top;
+  column -= root_left;
+  if (row < 0 || column < 0 || row >= std::int64_t(1) << root_level ||
+      column >= std::int64_t(1) << root_level)
+    return Cell::dead;
+
+  const Node *current = root;
+  for (unsigned level = root_level; level > 0; --level) {
+    const std::int64_t half = std::int64_t(1) << (level - 1);
+    if (row < half)
+      current = column < half ? current->nw : current->ne;
+    else
+      current = column < half ? current->sw : current->se;
+    row %= half;
+    column %= half;
+  }
+  return current->population ? Cell::alive : Cell::dead;
+}
+
+std::uint64_t HashLife::population() const { return root->population; }
+
+HashLife::Node *HashLife::expand(Node *current) {
+  Node *border = empty(root_level - 1);
+  const std::int64_t half = std::int64_t(1) << (root_level - 1);
+  root_level++;
+  root_top -= half;
+  root_left -= half;
+  return node(node(border, border, border, current->nw),
+              node(border, border, current->ne, border),
+              node(border, current->sw, border, border),
+              node(current->se, border, border, border));
+}
+
+HashLife::Node *HashLife::centre(Node *current) {
+  return node(current->nw->se, current->ne->sw, current->sw->ne,
+              current->se->nw);
+}
+
+bool HashLife::fits_in_centre() const {
+  const std::uint64_t inner =
+      root->nw->se->se->population + root->ne->sw->sw->population +
+      root->sw->ne->ne->population + root->se->nw->nw->population;
+  return inner == root->population;
+}
+
+HashLife::Node *HashLife::advance_level_2(Node *current) {
+  // Cells of the 4x4 square, row by row, one bit per cell.
+  unsigned cells = 0;
+  const Node *quadrants[4] = {current->nw, current->ne, current->sw,
+                              current->se};
+  for (unsigned i = 0; i < 4; ++i) {
+    for (unsigned j = 0; j < 4; ++j) {
+      const Node *quadrant = quadrants[(i / 2) * 2 + j / 2];
+      const Node *children[4] = {quadrant->nw, quadrant->ne, quadrant->sw,
+                                 quadrant->se};
+      if (children[(i % 2) * 2 + j % 2]->population)
+        cells |= 1u << (i * 4 + j);
+    }
+  }
+
+  Node *next[4];
+  for (unsigned i = 1; i < 3; ++i) {
+    for (unsigned j = 1; j < 3; ++j) {
+      unsigned count_neighbors = 0;
+      for (const auto &offset : NEIGHBOURHOOD)
+        count_neighbors +=
+            (cells >> ((i + offset.first) * 4 + j + offset.second)) & 1;
+      const bool alive = (cells >> (i * 4 + j)) & 1;
+      const std::uint16_t states = alive ? rule.survival : rule.birth;
+      next[(i - 1) * 2 + j - 1] =
+          leaf(states >> count_neighbors & 1 ? Cell::alive : Cell::dead);
+    }
+  }
+  return node(next[0], next[1], next[2], next[3]);
+}
+
+HashLife::Node *HashLife::advance(Node *current, unsigned exponent) {
+  if (current->population == 0)
+    return empty(current->level - 1);
+  if (current->result && current->result_exponent == exponent)
+    return current->result;
+  if (current->level == 2)
+    return current->result = advance_level_2(current);
+
+  // Nine overlapping squares of half the size covering the node.
+  Node *squares[3][3] = {
+      {current->nw, node(current->nw->ne, current->ne->nw, current->nw->se,
+                         current->ne->sw),
+       current->ne},
+      {node(current->nw->sw, current->nw->se, current->sw->nw,
+            current->sw->ne),
+       centre(current),
+       node(current->ne->sw, current->ne->se, current->se->nw,
+            current->se->ne)},
+      {current->sw, node(current->sw->ne, current->se->nw, current->sw->se,
+                         current->se->sw),
+       current->se}};
+
+  // At full speed both halves of the advance take 2^(level - 3)
+  // generations; otherwise the first one takes them all and the second one
+  // just keeps the centre.
+  const bool full_speed = exponent == current->level - 2;
+  const unsigned first_exponent = full_speed ? exponent - 1 : exponent;
+  Node *advanced[3][3];
+  for (unsigned i = 0; i < 3; ++i) {
+    for (unsigned j = 0; j < 3; ++j)
+      advanced[i][j] = advance(squares[i][j], first_exponent);
+  }
+
+  Node *quarters[2][2];
+  for (unsigned i = 0; i < 2; ++i) {
+    for (unsigned j = 0; j < 2; ++j) {
+      Node *quarter = node(advanced[i][j], advanced[i][j + 1],
+                           advanced[i + 1][j], advanced[i + 1][j + 1]);
+      quarters[i][j] =
+          full_speed ? advance(quarter, exponent - 1) : centre(quarter);
+    }
+  }
+
+  current->result_exponent = exponent;
+  return current->result = node(quarters[0][0], quarters[0][1],
+                                quarters[1][0], quarters[1][1]);
+}
+
+void HashLife::step_power_of_two(unsigned exponent) {
+  PROFILE_SCOPE("advance");
+  while (root_level < exponent + 3 || !fits_in_centre())
+    root = expand(root);
+
+  const std::int64_t quarter = std::int64_t(1) << (root_level - 2);
+  root = advance(root, exponent);
+  root_level--;
+  root_top += quarter;
+  root_left += quarter;
+  generations += std::uint64_t(1) << exponent;
+
+  if (nodes_in_use * sizeof(Node) + buckets.size() * sizeof(Node *) >
+      memory_limit)
+    collect_garbage();
+}
+
+void HashLife::step(std::uint64_t generations) {
+  for (unsigned exponent = 0; generations; ++exponent, generations >>= 1) {
+    if (generations & 1)
+      step_power_of_two(exponent);
+  }
+}
+
+void HashLife::mark(Node *current) {
+  if (current->level == 0 || current->marked)
+    return;
+  current->marked = true;
+  mark(current->nw);
+  mark(current->ne);
+  mark(current->sw);
+  mark(current->se);
+}
+
+void HashLife::collect_garbage() {
+  PROFILE_SCOPE("collect_garbage");
+  mark(root);
+  for (Node *empty_node : empties)
+    mark(empty_node);
+
+  // Cached results are kept only when the node they point to survives.
+  for (auto &block : blocks) {
+    for (Node &current : block->nodes) {
+      if (current.nw && current.marked && current.result &&
+          !current.result->marked)
+        current.result = nullptr;
+    }
+  }
+
+  std::fill(buckets.begin(), buckets.end(), nullptr);
+  for (auto &block : blocks) {
+    for (Node &current : block->nodes) {
+      if (!current.nw)
+        continue;
+      if (current.marked) {
+        current.marked = false;
+        Node *&bucket = buckets[hash_children(current.nw, current.ne,
+                                              current.sw, current.se) &
+                                (buckets.size() - 1)];
+        current.next = bucket;
+        bucket = &current;
+      } else {
+        current.nw = nullptr;
+        current.next = free_nodes;
+        free_nodes = &current;
+        nodes_in_use--;
+      }
+    }
+  }
+  collection_count++;
+}
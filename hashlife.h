@@ -0,0 +1,236 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file declares a HashLife engine for Conway's Game of Life, able to
+ * jump billions of generations ahead on regular patterns.
+ *
+ * The universe is stored as a quadtree whose nodes are hash-consed: two
+ * squares with the same cells are always the same node, so repeated regions
+ * of space and time are only computed once. Each node caches the result of
+ * advancing its centre, which is what makes advancing by 2^k generations as
+ * cheap as a single step on regular patterns.
+ *
+ * Unlike the boards of game_of_life.h the HashLife universe is an unbounded
+ * plane, not a torus: a pattern leaving the initial board keeps going.
+ *
+ * @see https://en.wikipedia.org/wiki/Hashlife
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#ifndef HASHLIFE_H
+#define HASHLIFE_H
+
+#include "game_of_life.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * HashLife universe on an unbounded plane.
+ *
+ * Cells are addressed by signed (row, column) coordinates. Loading a board
+ * places its cell (i, j) at (i, j), so the board area can be read back after
+ * advancing the universe.
+ */
+class HashLife {
+public:
+  /// Default limit of the memory used by the nodes, in bytes
+  static const size_t DEFAULT_MEMORY_LIMIT = size_t(512) << 20;
+
+  /**
+   * Creates an empty universe following the rule selected when it is created,
+   * as its cached results depend on it.
+   *
+   * @param memory_limit size_t with the number of bytes the nodes may use
+   * before unreachable nodes and their cached results are collected.
+   */
+  explicit HashLife(size_t memory_limit = DEFAULT_MEMORY_LIMIT);
+  ~HashLife();
+
+  HashLife(const HashLife &) = delete;
+  HashLife &operator=(const HashLife &) = delete;
+
+  /**
+   * Replaces the universe by the cells of a board, at generation 0.
+   *
+   * @tparam Grid Board or PackedBoard to be loaded.
+   * @param board Grid passed as const reference to be loaded.
+   */
+  template <typename Grid> void load(const Grid &board) {
+    clear();
+    for (size_t i = 0; i < board.height(); ++i) {
+      for (size_t j = 0; j < board.width(); ++j) {
+        if (board.get(i, j) == Cell::alive)
+          set(i, j, Cell::alive);
+      }
+    }
+  }
+
+  /// Kills every cell and resets the generation to 0
+  void clear();
+
+  /**
+   * Sets the state of a cell.
+   *
+   * @param row int64_t with the row of the cell.
+   * @param column int64_t with the column of the cell.
+   * @param cell Cell with the new state.
+   */
+  void set(std::int64_t row, std::int64_t column, Cell cell);
+
+  /**
+   * Gets the state of a cell.
+   *
+   * @param row int64_t with the row of the cell.
+   * @param column int64_t with the column of the cell.
+   * @return Cell with the state of the cell.
+   */
+  Cell get(std::int64_t row, std::int64_t column) const;
+
+  /**
+   * Copies a region of the universe into a board.
+   *
+   * Empty nodes are skipped as a whole, so reading a sparse region costs
+   * little more than clearing the board.
+   *
+   * @tparam Grid Board or PackedBoard receiving the cells.
+   * @param board Grid passed by reference, whose size is the size of the
+   * region.
+   * @param top int64_t with the row of the universe copied to row 0.
+   * @param left int64_t with the column of the universe copied to column 0.
+   */
+  template <typename Grid>
+  void read(Grid &board, std::int64_t top = 0, std::int64_t left = 0) const {
+    clear_region(board, 0, board.height(), 0, board.width());
+    read_node(root, root_level, root_top - top, root_left - left,
+              board.height(), board.width(),
+              [&](size_t i, size_t j) { board.set(i, j, Cell::alive); });
+  }
+
+  /**
+   * Advances the universe by 2^exponent generations.
+   *
+   * @param exponent unsigned with the base 2 logarithm of the number of
+   * generations, e.g. 40 to advance by 2^40 generations.
+   */
+  void step_power_of_two(unsigned exponent);
+
+  /**
+   * Advances the universe by any number of generations.
+   *
+   * The generations are decomposed into powers of two, each taken with
+   * step_power_of_two.
+   *
+   * @param generations uint64_t with the number of generations.
+   */
+  void step(std::uint64_t generations = 1);
+
+  /// Number of generations since the universe was loaded or cleared
+  std::uint64_t generation() const { return generations; }
+
+  /// Number of living cells
+  std::uint64_t population() const;
+
+  /// Number of nodes currently allocated
+  size_t node_count() const { return nodes_in_use; }
+
+  /// Number of garbage collections run so far
+  size_t collections() const { return collection_count; }
+
+  /// Removes the nodes that are not reachable from the current universe
+  void collect_garbage();
+
+private:
+  struct Node;
+  struct NodeBlock;
+
+  Node *leaf(Cell cell) const;
+  Node *empty(unsigned level);
+  Node *node(Node *nw, Node *ne, Node *sw, Node *se);
+  Node *allocate();
+  void rehash(size_t buckets);
+  Node *set_node(Node *current, unsigned level, std::int64_t row,
+                 std::int64_t column, Cell cell);
+  Node *expand(Node *current);
+  Node *centre(Node *current);
+  Node *advance(Node *current, unsigned exponent);
+  Node *advance_level_2(Node *current);
+  bool fits_in_centre() const;
+  void mark(Node *current);
+
+  /**
+   * Calls visit(i, j) for every living cell of a node placed at (top, left)
+   * that falls in the region [0, rows) x [0, columns).
+   */
+  template <typename Visit>
+  void read_node(const Node *current, unsigned level, std::int64_t top,
+                 std::int64_t left, std::int64_t rows, std::int64_t columns,
+                 const Visit &visit) const;
+
+  Rule rule;
+  size_t memory_limit;
+  std::vector<std::unique_ptr<NodeBlock>> blocks;
+  Node *free_nodes = nullptr;
+  size_t nodes_in_use = 0;
+  size_t collection_count = 0;
+
+  std::vector<Node *> buckets; ///< Hash table of the canonical nodes
+  std::vector<Node *> empties; ///< Empty node of each level
+  std::unique_ptr<Node> leaves[2];
+
+  Node *root = nullptr;
+  unsigned root_level = 0;
+  std::int64_t root_top = 0;  ///< Row of the top left cell of the root
+  std::int64_t root_left = 0; ///< Column of the top left cell of the root
+  std::uint64_t generations = 0;
+};
+
+/// Node of the quadtree, a square of 2^level x 2^level cells
+struct HashLife::Node {
+  Node *nw = nullptr, *ne = nullptr, *sw = nullptr, *se = nullptr;
+  Node *result = nullptr; ///< Centre advanced by 2^result_exponent generations
+  Node *next = nullptr;   ///< Next node in the same bucket, or free node
+  std::uint64_t population = 0;
+  unsigned level = 0;
+  unsigned result_exponent = 0;
+  bool marked = false;
+};
+
+template <typename Visit>
+void HashLife::read_node(const Node *current, unsigned level, std::int64_t top,
+                         std::int64_t left, std::int64_t rows,
+                         std::int64_t columns, const Visit &visit) const {
+  const std::int64_t size = std::int64_t(1) << level;
+  if (current->population == 0 || top >= rows || left >= columns ||
+      top + size <= 0 || left + size <= 0)
+    return;
+  if (level == 0) {
+    visit(top, left);
+    return;
+  }
+  const std::int64_t half = size / 2;
+  read_node(current->nw, level - 1, top, left, rows, columns, visit);
+  read_node(current->ne, level - 1, top, left + half, rows, columns, visit);
+  read_node(current->sw, level - 1, top + half, left, rows, columns, visit);
+  read_node(current->se, level - 1, top + half, left + half, rows, columns,
+            visit);
+}
+
+#endif // HASHLIFE_H
@@ -25,18 +25,147 @@
  *
  * Basic build instructions
  *
- * compile: g++ main.cpp -std=c++17 -o main
+ * compile: make
+ *      or g++ main.cpp game_of_life.cpp hashlife.cpp sparse_world.cpp
+ *         snapshot.cpp patterns.cpp profiler.cpp cycle_detector.cpp
+ *         ensemble.cpp gpu_world.cpp engine.cpp viewport.cpp
+ *         frame_export.cpp grid_memory.cpp -std=c++17 -O2 -pthread -o main
+ * profiling build: make clean && make PROFILE=1
+ * GPU build: make clean && make GPU=1 (needs nvcc and the CUDA runtime)
  * run it: ./main
+ * benchmarks: make benchmark && ./benchmark (needs Google Benchmark)
  *
  * Usage
  *
  * Once build the binary can be used standalone or with some specific flags:
- *  -s sets the size of the board.
+ *  -s sets the size of the board, either square or as width x height.
  *      ./main -s 50 //for a board with 50x50 cells
- *  -n sets the initial number of living cells
+ *      ./main -s 80x40 //for a board 80 cells wide and 40 cells tall
+ *  -n sets the initial number of living cells, placed at random
  *      ./main -n 20 //to start with 20 living cells
+ *  --density sets the probability of each initial cell to be alive instead
+ *      ./main -p -s 32768 --density 0.3 //to start with a 30% soup
+ *  --seed sets the seed of the random cells of -n and --density, random by
+ *     default and shown by -b. The same seed gives the same cells with any
+ *     number of threads and with or without -p
+ *      ./main -b --seed 42 //to measure the same board on every run
  *  -m sets the maximum number of generations
  *      ./main -m 100 //to run the game for maximum of 100 generations
+ *  --engine selects the engine stepping the game, naive by default:
+ *      naive stores a byte per cell, the reference of the other engines
+ *      packed stores a bit per cell, stepped by the portable scalar kernel
+ *      simd stores a bit per cell, stepped by the fastest kernel of the CPU
+ *      parallel is simd with a thread per core, unless -t is given
+ *      hashlife and sparse are the engines of -l and -u
+ *      gpu is the engine of -g
+ *      ./main -b -s 4096 --engine packed //to measure the portable kernel
+ *  -p is --engine simd
+ *      ./main -p -s 4096 //to run a large board with the bit-packed stepper
+ *  -t sets the number of threads used to update the board
+ *      ./main -t 8 //to split the board in 8 bands of rows
+ *  -f renders only one of every given number of generations
+ *      ./main -f 10 //to draw the board every 10 generations
+ *  --gps sets the number of generations computed per second, 0 for as many
+ *     as the engine can, 10 times -f by default; with -k a step of 2^k
+ *     generations counts as one. The game runs on its own thread, so the
+ *     rendering never slows it down
+ *      ./main -p -s 200 --gps 0 -m 100000 //to watch a soup at full speed
+ *  --fps sets the number of frames drawn per second, 10 by default, each one
+ *     showing the last generation computed when it is drawn
+ *      ./main --gps 240 --fps 60 //to follow a fast game smoothly
+ *  --view draws a window of the board sized to the terminal instead of the
+ *     whole board: braille shows 2x4 dots per character, half shows 1x2 dots
+ *     shaded in grey by the density of their cells. Each dot covers a square
+ *     of 2^zoom cells per side, taken from the populations of the tiles of
+ *     the board, so large boards render as fast as small ones. While playing
+ *     the arrows or h, j, k and l pan the view, + and - zoom in and out
+ *      ./main -p -s 16384 --density 0.3 --view braille //to watch a big soup
+ *  --zoom sets the zoom of --view, 0 for a dot per cell, by default the
+ *     smallest showing the whole board
+ *  --at sets the row and column of the top left cell of --view, 0,0 by
+ *     default
+ *      ./main -p -s 4096 -P gun.rle@2000,2000 --view half --zoom 0 --at
+ *      1990,1990 //to look closely at the gun
+ *  -b runs headless, with no rendering and no delay between generations,
+ *     and reports the stepping throughput
+ *      ./main -b -p -s 4096 -m 1000 //to measure 1000 generations
+ *  -j prints the report of -b as JSON
+ *      ./main -b -j > result.json //to feed a performance dashboard
+ *  -w updates the board in tiles of 64 rows, 64 columns wide or 512 with -p,
+ *     shared between the threads by work stealing. Only the tiles next to a
+ *     tile that changed in the previous generation are updated, and tiles with
+ *     no living cell in or around them are just cleared.
+ *      ./main -w -t 8 //to balance clustered patterns between 8 threads
+ *  -l is --engine hashlife, running HashLife on an unbounded plane instead of
+ *     a torus; the board only sets the initial cells and the region shown
+ *      ./main -l -b -m 1000000000 //to reach generation one billion
+ *  -r sets the rule in B/S notation, Conway's B3/S23 by default. The rules
+ *     listed by select_rule in game_of_life.h have compiled steppers, the
+ *     others run slower generic ones
+ *      ./main -r B36/S23 //to play HighLife
+ *  -u is --engine sparse, running on an unbounded plane and storing only the
+ *     64x64 chunks holding living cells
+ *      ./main -u -b -m 100000 //to follow the gliders escaping the board
+ *  -g is --engine gpu, running on a torus kept in the memory of a CUDA
+ *     device and reading it back only to render it or to write the
+ *     snapshots of -o. It needs a build with make GPU=1, and does not work
+ *     with -i, --cycles nor --batch
+ *      ./main -g -b -s 32768 -m 10000 //to step a billion cells on the GPU
+ *  -k advances 2^k generations per frame with -l, -u or -g
+ *      ./main -l -k 10 //to show one frame every 1024 generations
+ *  -o writes a snapshot of the board to a file at the end of the game
+ *      ./main -b -p -s 65536 -m 100000 -o run.snap //to keep the last board
+ *  -c writes the snapshots of -o every given number of generations too, from
+ *     a background thread
+ *      ./main -o run.snap -c 1000 //to checkpoint every 1000 generations
+ *  -i restores the board, the generation and the rule of a snapshot, mapping
+ *     it in memory instead of reading it. -s, -n and -r are ignored. -i, -o
+ *     and -c need a board, they do not work with -l nor -u
+ *      ./main -i run.snap -o run.snap -c 1000 //to resume a checkpointed run
+ *  --cycles ends the game when the board repeats with a period up to the
+ *     given number of generations, 1 catching only still lifes, and reports
+ *     the period. Boards are told apart by a hash updated with the cells that
+ *     changed, it does not work with -l nor -u
+ *      ./main -b -s 1024 -m 100000 --cycles 30 //to stop once it settles
+ *  --batch plays the given number of independent boards to their end, with
+ *     the seeds following --seed, -t boards at a time, and writes a line of
+ *     CSV per board with its seed, generations, population, period and
+ *     outcome. Still lifes and oscillators up to the period of --cycles, 30
+ *     by default, end a board early. It uses -s, -n, --density, -m, -p and -r
+ *      ./main --batch 10000 --seed 1 -s 64 -n 800 -m 5000 -t 8 //to study soups
+ *  --csv sets the file receiving the CSV of --batch, the standard output by
+ *     default
+ *  --export runs like -b and streams the board every -f generations to a
+ *     file, or to the standard output for -, encoded from a background
+ *     thread. The report of -b then goes to the standard error
+ *      ./main -p -s 1024 -m 5000 --export run.gol //to record a run
+ *  --export-format sets the encoding of --export, see frame_export.h:
+ *      delta writes the words that changed since the previous frame, coded
+ *        as runs, by default
+ *      bits writes the whole bit packed board
+ *      pgm writes binary PGM images, y4m a monochrome YUV4MPEG2 video at
+ *        --fps frames per second
+ *      ./main -p -s 512 -m 600 --export - --export-format y4m --fps 30 |
+ *      ffmpeg -i - run.mp4 //to encode a video
+ *  --hugepages maps the grids on huge pages: 1 GiB or 2 MiB pages when the
+ *     administrator reserved some, transparent huge pages otherwise. With -t
+ *     the rows of each thread are placed on its NUMA node either way, and the
+ *     report of -b tells the pages obtained and the node of the grids. It
+ *     needs a grid, it does not work with -l, -u, -g nor --batch
+ *      ./main -b -p -s 16384 -t 16 --hugepages //to cut the TLB misses
+ *  --profile writes the time spent in each phase of every generation, by
+ *     every thread, to a CSV table, or to a Chrome trace if the file ends in
+ *     .json. It needs a build with make PROFILE=1, which compiles the timers
+ *     in
+ *      ./main -b -p -s 4096 --profile run.json //to open in ui.perfetto.dev
+ *  -M sets the memory, in MiB, HashLife may use before collecting its cache
+ *      ./main -l -M 2048 //to let the cache grow up to 2 GiB
+ *  -P loads an RLE or plaintext (.cells) pattern file, or - for the standard
+ *     input, instead of the random cells of -n. The pattern is placed at row
+ *     0 and column 0 unless followed by @row,column, and wraps around the
+ *     edges of the board. -P can be repeated, and the rule in the header of
+ *     the first pattern is used unless -r is given or -i restores one
+ *      ./main -s 200 -P gun.rle@10,20 //to start with a gun at row 10
  *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -53,227 +182,1031 @@
  * @see github.com/lacouth/cpp_game_of_life
  */
 
-#include <algorithm>
+#include "cycle_detector.h"
+#include "engine.h"
+#include "ensemble.h"
+#include "frame_export.h"
+#include "game_of_life.h"
+#include "gpu_world.h"
+#include "hashlife.h"
+#include "patterns.h"
+#include "profiler.h"
+#include "snapshot.h"
+#include "sparse_world.h"
+#include "triple_buffer.h"
+#include "viewport.h"
+
 #include <chrono>
+#include <exception>
+#include <fstream>
+#include <getopt.h>
 #include <iostream>
-#include <random>
+#include <memory>
 #include <string>
 #include <thread>
 #include <unistd.h>
 #include <vector>
 
-/**
- * Possible cell's states in the game.
- * These values are used to impose the only two states a cell can assume during
- * the game.
- */
-enum class Cell { dead, alive };
-
-// Type definition of the Row being a std::vector of Cells
-typedef std::vector<Cell> Row;
-
-// Type definition of the Board being a std::vector of Rows
-typedef std::vector<Row> Board;
+/// Pattern file loaded by -P, with the position of its top left cell
+struct PatternPlacement {
+  std::string path;
+  size_t top = 0;
+  size_t left = 0;
+};
 
-const std::string ALIVE_SYMBOL = " o "; ///< Symbol used in terminal to represents a live cell
-const std::string DEAD_SYMBOL = " _ "; ///<  Symbol used in terminal to represents a dead cell
-const int MIN_NEIGHBOURS = 2; ///< Game constant to define underpopulation
-const int MAX_NEIGHBOURS = 3; ///< Game constant to define overpopuplation
+/// Settings of a game played on the terminal
+struct GameOptions {
+  size_t width = 50;            ///< Number of columns of the board
+  size_t height = 50;           ///< Number of rows of the board
+  size_t living_cells = 200;    ///< Initial number of living cells
+  double density = 0; ///< Probability of a living cell, or 0 to use -n
+  std::uint64_t seed = random_seed(); ///< Seed of the random cells
+  size_t max_generations = 100; ///< Maximum number of generations
+  Engine engine = Engine::naive; ///< Engine stepping the game
+  size_t threads = 1;           ///< Number of threads updating the board
+  Schedule schedule = Schedule::bands; ///< How threads share the board
+  size_t frame_skip = 1; ///< Generations between two rendered frames
+  double generations_per_second = 0; ///< Pace of the game, or 0 for no limit
+  double frames_per_second = 10;     ///< Pace of the rendering
+  ViewMode view = ViewMode::cells;   ///< How the board is drawn
+  Viewport viewport;    ///< Window drawn by --view, from --at and --zoom
+  bool fit_view = true; ///< Whether to zoom out until the board fits
+  bool headless = false; ///< Whether to run without rendering nor sleeping
+  bool json = false;     ///< Whether to print the headless report as JSON
+  unsigned step_exponent = 0; ///< Planes advance 2^step_exponent per step
+  size_t memory_limit = HashLife::DEFAULT_MEMORY_LIMIT; ///< HashLife cache cap
+  std::shared_ptr<Snapshot> restored; ///< Board of -i or -P, if any
+  std::vector<PatternPlacement> patterns; ///< Pattern files loaded by -P
+  std::string snapshot_path;          ///< File receiving the snapshots of -o
+  size_t snapshot_interval = 0; ///< Generations between two snapshots, or 0
+  size_t max_period = 0; ///< Longest period found by --cycles, or 0 for none
+  size_t batch_runs = 0; ///< Number of boards played by --batch, or 0
+  std::string csv_path = "-"; ///< File receiving the CSV of --batch
+  std::string export_path;    ///< File receiving the frames of --export
+  ExportFormat export_format = ExportFormat::delta; ///< Encoding of --export
+  bool huge_pages = false; ///< Whether --hugepages maps the grids on huge pages
+};
 
 /**
- * Creates a square board to the game of life
+ * Plays the game on the terminal until everybody is dead or the maximum
+ * number of generations is reached.
  *
- * @param size size_t whose value is used to create a square board.
- * @param initial_value Cell indicates the initial state of all cells in the
- * board, the default value is set to Cell::dead
- * @return a new Board with the configurations established by the parameters
- * above.
+ * @tparam Grid Board or PackedBoard used to store the cells.
+ * @param options const GameOptions with the settings of the game.
  */
-
-Board board_factory(size_t size, Cell initial_value = Cell::dead);
-
-/**
- * Populates the board with living cells
- * @param board Board passsed by reference to be populated.
- * @param number_of_cells size_t defines the number of random generated
- * positions should be set as Cell::alive.
- */
-
-void generates_board_initial_state(Board &board, size_t number_of_cells);
+template <typename Grid> void play(const GameOptions &options);
 
 /**
- * Prints the Board on the standard output
+ * Runs the game with no rendering nor delay and reports its throughput.
  *
- * Uses the ALIVE_SYMBOL and the DEAD_SYMBOL to represents the cells state.
+ * Prints the wall time, the generations per second and the cell updates per
+ * second of the stepping loop, either as text or as a JSON object.
  *
- * @param board Board passed as const reference to be printed
+ * @tparam Grid Board or PackedBoard used to store the cells.
+ * @param options const GameOptions with the settings of the game.
  */
-
-void print_board(const Board &board);
+template <typename Grid> void benchmark(const GameOptions &options);
 
 /**
- * Updates a board using the three rules of Conway's Game of Life.
+ * Plays the independent boards of --batch and reports their outcomes as CSV.
  *
- * @param board Board passed by referece to be updated.
+ * @param options const GameOptions with the settings of the boards.
  */
-void update_board(Board &board);
+void batch(const GameOptions &options);
 
 /**
- * Gets a valid position of the neighbour of a cell
+ * Plays the game on the terminal with an engine running on an unbounded
+ * plane, or on the device with -g, showing the board area of the plane.
  *
- * @param coord const Container with the Board indexes of a cell.
- * @param positions const Container with the directions of the neighbour to be
- * calculated.
- * @param board_size size_t with the size of the Board.
- * @return std::pair<int,int> with the indexes of the neighbour in the given
- * direction.
+ * @tparam Universe HashLife, SparseWorld or GpuWorld.
+ * @param universe Universe passed by reference, replaced by the initial board.
+ * @param options const GameOptions with the settings of the game.
  */
-std::pair<int, int> neighbour_position(const std::vector<int> &coord,
-                                       const std::vector<size_t> positions,
-                                       size_t board_size);
+template <typename Universe>
+void play_plane(Universe &universe, const GameOptions &options);
 
 /**
- * Runs through a Board looking for a living cell
+ * Runs an engine on an unbounded plane, or on the device with -g, with no
+ * rendering and reports its throughput.
  *
- * @param board Board passed as a const reference
- * @return bool return true if all cells are marked as dead, false if there is
- * at least one cell alive.
- * @note if the cell is on the edge of the board the neighbours will be set as
- * the cells in the on the other side of the board, creating the illusion of a
- * round board.
+ * @tparam Universe HashLife, SparseWorld or GpuWorld.
+ * @param universe Universe passed by reference, replaced by the initial board.
+ * @param options const GameOptions with the settings of the game.
  */
+template <typename Universe>
+void benchmark_plane(Universe &universe, const GameOptions &options);
 
-bool is_everybody_dead(const Board &board);
+/// Values returned by getopt_long for the options without a short name
+enum LongOption {
+  SEED_OPTION = 256,
+  DENSITY_OPTION,
+  PROFILE_OPTION,
+  CYCLES_OPTION,
+  BATCH_OPTION,
+  CSV_OPTION,
+  ENGINE_OPTION,
+  GPS_OPTION,
+  FPS_OPTION,
+  VIEW_OPTION,
+  ZOOM_OPTION,
+  AT_OPTION,
+  EXPORT_OPTION,
+  EXPORT_FORMAT_OPTION,
+  HUGEPAGES_OPTION
+};
 
 int main(int argc, char **argv) {
 
-  size_t board_size = 50;
-  uint number_initial_living_cells = 200;
-  size_t generations = 0;
-  size_t max_generations = 100;
+  GameOptions options;
+  std::string restore_path;
+  bool rule_given = false;
+  std::string profile_path;
+  bool threads_given = false;
+  bool pace_given = false;
+  const option long_options[] = {
+      {"seed", required_argument, nullptr, SEED_OPTION},
+      {"density", required_argument, nullptr, DENSITY_OPTION},
+      {"profile", required_argument, nullptr, PROFILE_OPTION},
+      {"cycles", required_argument, nullptr, CYCLES_OPTION},
+      {"batch", required_argument, nullptr, BATCH_OPTION},
+      {"csv", required_argument, nullptr, CSV_OPTION},
+      {"engine", required_argument, nullptr, ENGINE_OPTION},
+      {"gps", required_argument, nullptr, GPS_OPTION},
+      {"fps", required_argument, nullptr, FPS_OPTION},
+      {"view", required_argument, nullptr, VIEW_OPTION},
+      {"zoom", required_argument, nullptr, ZOOM_OPTION},
+      {"at", required_argument, nullptr, AT_OPTION},
+      {"export", required_argument, nullptr, EXPORT_OPTION},
+      {"export-format", required_argument, nullptr, EXPORT_FORMAT_OPTION},
+      {"hugepages", no_argument, nullptr, HUGEPAGES_OPTION},
+      {nullptr, 0, nullptr, 0}};
 
   while (true) {
-    switch (getopt(argc, argv, "s:n:m:")) {
-    case 's':
-      board_size = std::stoi(optarg);
+    switch (getopt_long(argc, argv, "s:n:m:pt:wf:bjlugk:M:r:i:o:c:P:",
+                        long_options, nullptr)) {
+    case 's': {
+      const std::string size(optarg);
+      const size_t separator = size.find('x');
+      options.width = std::stoi(size.substr(0, separator));
+      options.height = separator == std::string::npos
+                           ? options.width
+                           : std::stoi(size.substr(separator + 1));
       continue;
+    }
     case 'n':
-      number_initial_living_cells = std::stoi(optarg);
+      options.living_cells = std::stoull(optarg);
+      continue;
+    case DENSITY_OPTION:
+      options.density = std::stod(optarg);
+      continue;
+    case SEED_OPTION:
+      options.seed = std::stoull(optarg, nullptr, 0);
+      continue;
+    case CYCLES_OPTION:
+      options.max_period = std::stoull(optarg);
+      continue;
+    case BATCH_OPTION:
+      options.batch_runs = std::stoull(optarg);
+      continue;
+    case CSV_OPTION:
+      options.csv_path = optarg;
+      continue;
+    case GPS_OPTION:
+      options.generations_per_second = std::max(0.0, std::stod(optarg));
+      pace_given = true;
+      continue;
+    case FPS_OPTION:
+      options.frames_per_second = std::max(0.1, std::stod(optarg));
+      continue;
+    case VIEW_OPTION:
+      if (!parse_view_mode(optarg, options.view)) {
+        std::cerr << "Invalid view " << optarg
+                  << ", expected cells, braille or half\n";
+        return 1;
+      }
+      continue;
+    case ZOOM_OPTION:
+      options.viewport.zoom =
+          std::min<int>(MAX_ZOOM, std::max(0, std::stoi(optarg)));
+      options.fit_view = false;
+      continue;
+    case AT_OPTION: {
+      const std::string position(optarg);
+      const size_t comma = position.find(',');
+      options.viewport.top = std::stoull(position.substr(0, comma));
+      options.viewport.left = comma == std::string::npos
+                                  ? 0
+                                  : std::stoull(position.substr(comma + 1));
+      continue;
+    }
+    case EXPORT_OPTION:
+      options.export_path = optarg;
+      options.headless = true;
+      continue;
+    case EXPORT_FORMAT_OPTION:
+      if (!parse_export_format(optarg, options.export_format)) {
+        std::cerr << "Invalid export format " << optarg
+                  << ", expected bits, delta, pgm or y4m\n";
+        return 1;
+      }
+      continue;
+    case HUGEPAGES_OPTION:
+      options.huge_pages = true;
+      continue;
+    case ENGINE_OPTION:
+      if (!parse_engine(optarg, options.engine)) {
+        std::cerr << "Invalid engine " << optarg << ", expected one of "
+                  << engine_list() << "\n";
+        return 1;
+      }
+      continue;
+    case PROFILE_OPTION:
+      if (!PROFILING_ENABLED) {
+        std::cerr << "--profile needs a build with make PROFILE=1\n";
+        return 1;
+      }
+      profile_path = optarg;
       continue;
     case 'm':
-      max_generations = std::stoi(optarg);
+      options.max_generations = std::stoull(optarg);
+      continue;
+    case 'p':
+      options.engine = Engine::simd;
+      continue;
+    case 't':
+      options.threads = std::max(1, std::stoi(optarg));
+      threads_given = true;
+      continue;
+    case 'w':
+      options.schedule = Schedule::tiles;
+      continue;
+    case 'f':
+      options.frame_skip = std::max(1, std::stoi(optarg));
+      continue;
+    case 'b':
+      options.headless = true;
+      continue;
+    case 'j':
+      options.json = true;
+      continue;
+    case 'l':
+      options.engine = Engine::hashlife;
       continue;
+    case 'u':
+      options.engine = Engine::sparse;
+      continue;
+    case 'g':
+      options.engine = Engine::gpu;
+      continue;
+    case 'k':
+      options.step_exponent = std::min(62, std::max(0, std::stoi(optarg)));
+      continue;
+    case 'M':
+      options.memory_limit = std::stoull(optarg) << 20;
+      continue;
+    case 'r': {
+      Rule rule;
+      if (!parse_rule(optarg, rule)) {
+        std::cerr << "Invalid rule " << optarg << ", expected e.g. B36/S23\n";
+        return 1;
+      }
+      select_rule(rule);
+      rule_given = true;
+      continue;
+    }
+    case 'i':
+      restore_path = optarg;
+      continue;
+    case 'o':
+      options.snapshot_path = optarg;
+      continue;
+    case 'c':
+      options.snapshot_interval = std::stoull(optarg);
+      continue;
+    case 'P': {
+      PatternPlacement pattern;
+      pattern.path = optarg;
+      const size_t at = pattern.path.rfind('@');
+      if (at != std::string::npos) {
+        const std::string position = pattern.path.substr(at + 1);
+        const size_t comma = position.find(',');
+        pattern.top = std::stoull(position.substr(0, comma));
+        pattern.left = comma == std::string::npos
+                           ? 0
+                           : std::stoull(position.substr(comma + 1));
+        pattern.path.erase(at);
+      }
+      options.patterns.push_back(pattern);
+      continue;
+    }
     default:
       break;
     }
     break;
   }
 
-  Board board = board_factory(board_size);
+  const bool plane = options.engine == Engine::hashlife ||
+                     options.engine == Engine::sparse;
+  const bool gpu = options.engine == Engine::gpu;
+  if (gpu && !GPU_ENABLED) {
+    std::cerr << "The gpu engine needs a build with make GPU=1\n";
+    return 1;
+  }
+  if (plane && (!restore_path.empty() || !options.snapshot_path.empty())) {
+    std::cerr << "Snapshots need a board, they do not work with -l nor -u\n";
+    return 1;
+  }
+  if (options.batch_runs &&
+      (plane || !restore_path.empty() || !options.patterns.empty() ||
+       !options.snapshot_path.empty() || !options.export_path.empty())) {
+    std::cerr << "--batch plays random boards, it does not work with -l, -u, "
+                 "-i, -o, -P nor --export\n";
+    return 1;
+  }
+  if (plane && options.max_period) {
+    std::cerr << "--cycles needs a board, it does not work with -l nor -u\n";
+    return 1;
+  }
+  if (options.huge_pages && (plane || gpu || options.batch_runs)) {
+    std::cerr << "--hugepages maps the grids of a board, it does not work "
+                 "with -l, -u, -g nor --batch\n";
+    return 1;
+  }
+  if (gpu &&
+      (!restore_path.empty() || options.max_period || options.batch_runs)) {
+    std::cerr << "-g keeps the board on the device, it does not work with -i, "
+                 "--cycles nor --batch\n";
+    return 1;
+  }
 
-  generates_board_initial_state(board, number_initial_living_cells);
-  while (!is_everybody_dead(board) && generations < max_generations) {
-    print_board(board);
-    update_board(board);
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    generations++;
+  select_engine_kernel(options.engine);
+  // The game keeps the pace of the former 100 ms sleep per rendered frame.
+  if (!pace_given)
+    options.generations_per_second = 10.0 * options.frame_skip;
+  if (options.engine == Engine::parallel && !threads_given)
+    options.threads = std::max(1u, std::thread::hardware_concurrency());
+
+  if (!profile_path.empty())
+    start_profile();
+
+  try {
+    if (!restore_path.empty()) {
+      options.restored = std::make_shared<Snapshot>(load_snapshot(restore_path));
+      options.width = options.restored->board.width();
+      options.height = options.restored->board.height();
+      select_rule(options.restored->rule);
+    }
+
+    if (!options.patterns.empty() && !options.restored) {
+      options.restored = std::make_shared<Snapshot>();
+      options.restored->board = PackedBoard(options.width, options.height);
+    }
+    for (size_t k = 0; k < options.patterns.size(); ++k) {
+      const PatternPlacement &pattern = options.patterns[k];
+      const PatternInfo info = load_pattern(
+          pattern.path, options.restored->board, pattern.top, pattern.left);
+      if (k == 0 && info.has_rule && !rule_given && restore_path.empty())
+        select_rule(info.rule);
+    }
+
+    if (options.batch_runs) {
+      batch(options);
+    } else if (options.engine == Engine::hashlife) {
+      HashLife universe(options.memory_limit);
+      if (options.headless)
+        benchmark_plane(universe, options);
+      else
+        play_plane(universe, options);
+    } else if (options.engine == Engine::sparse) {
+      SparseWorld universe;
+      if (options.headless)
+        benchmark_plane(universe, options);
+      else
+        play_plane(universe, options);
+    } else if (gpu) {
+      GpuWorld universe(options.width, options.height);
+      if (options.headless)
+        benchmark_plane(universe, options);
+      else
+        play_plane(universe, options);
+    } else if (options.headless && options.engine != Engine::naive)
+      benchmark<PackedBoard>(options);
+    else if (options.headless)
+      benchmark<Board>(options);
+    else if (options.engine != Engine::naive)
+      play<PackedBoard>(options);
+    else
+      play<Board>(options);
+
+    if (!profile_path.empty())
+      write_profile(profile_path);
+  } catch (const std::runtime_error &error) {
+    std::cerr << error.what() << '\n';
+    return 1;
   }
-  print_board(board);
-  if (generations < max_generations)
-    std::cout << "GAME OVER - No Cells Alive\n";
-  else
-    std::cout << generations << " generations\n";
 }
 
 /*
     Implementations
 */
 
-Board board_factory(size_t size, Cell initial_value) {
-  return Board(size, Row(size, initial_value));
+/// Fills a board with the random cells of -n or --density
+template <typename Grid>
+void generates_random_start(Grid &board, const GameOptions &options) {
+  if (options.density > 0)
+    generates_board_random_state(board, options.density, options.seed,
+                                 options.threads);
+  else
+    generates_board_initial_state(board, options.living_cells, options.seed,
+                                  options.threads);
 }
 
-void generates_board_initial_state(Board &board, size_t number_of_cells) {
+/**
+ * Sets up the initial board, restored from the snapshot of -i, loaded from the
+ * patterns of -P or random.
+ *
+ * @return uint64_t with the generation of the initial board.
+ */
+std::uint64_t start_game(PackedBoard &board, const GameOptions &options) {
+  if (!options.restored) {
+    generates_random_start(board, options);
+    return 0;
+  }
+  // The mapped rows of the snapshot are moved in, not copied, unless the
+  // grids were mapped on huge pages for --hugepages.
+  if (options.huge_pages)
+    board = options.restored->board;
+  else
+    board = std::move(options.restored->board);
+  return options.restored->generation;
+}
 
-  std::random_device dev;
-  std::mt19937 rng(dev());
-  std::uniform_int_distribution<std::mt19937::result_type> random_number(
-      0, board.size() - 1);
+std::uint64_t start_game(Board &board, const GameOptions &options) {
+  if (!options.restored) {
+    generates_random_start(board, options);
+    return 0;
+  }
+  board = unpack_board(options.restored->board);
+  return options.restored->generation;
+}
+
+/**
+ * Writes a snapshot of the board with -o, every snapshot_interval generations
+ * and at the end of the game.
+ */
+template <typename Grid>
+void save_checkpoint(SnapshotWriter *snapshots, const GameOptions &options,
+                     const Grid &board, std::uint64_t generation, bool last) {
+  if (snapshots &&
+      (last || (options.snapshot_interval &&
+                generation % options.snapshot_interval == 0)))
+    snapshots->write(board, generation, selected_rule());
+  if (snapshots && last)
+    snapshots->wait();
+}
+
+/// Exporter of --export, or null
+std::unique_ptr<FrameExporter> frame_exporter(const GameOptions &options) {
+  return std::unique_ptr<FrameExporter>(
+      options.export_path.empty()
+          ? nullptr
+          : new FrameExporter(options.export_path, options.export_format,
+                              options.frames_per_second));
+}
+
+/// Stream of the headless reports, kept apart from frames exported to stdout
+std::ostream &report_stream(const GameOptions &options) {
+  return options.export_path == "-" ? std::cerr : std::cout;
+}
+
+/// Frames and bytes written by --export for the reports, empty without it
+std::string export_report(const FrameExporter *exporter,
+                          const GameOptions &options, bool json) {
+  if (!exporter)
+    return "";
+  const std::string format = export_format_string(options.export_format);
+  if (json)
+    return ", \"export_format\": \"" + format + "\", \"export_frames\": " +
+           std::to_string(exporter->frames()) + ", \"export_bytes\": " +
+           std::to_string(exporter->bytes());
+  return std::to_string(exporter->frames()) + " " + format +
+         " frames exported in " + std::to_string(exporter->bytes()) +
+         " bytes\n";
+}
+
+/// Cycle detector of --cycles, or null
+std::unique_ptr<CycleDetector> cycle_detector(const GameOptions &options) {
+  return std::unique_ptr<CycleDetector>(
+      options.max_period ? new CycleDetector(options.max_period) : nullptr);
+}
+
+/**
+ * Moves the cycle detector of --cycles to the last generation of world.
+ *
+ * @return size_t with the period of the board, or 0 if it does not repeat.
+ */
+template <typename Grid>
+size_t detect_cycle(CycleDetector *cycles, const World<Grid> &world) {
+  if (!cycles)
+    return 0;
+  PROFILE_SCOPE("detect_cycle");
+  return cycles->update(world.previous_board(), world.board());
+}
+
+/// Describes the period found at generation by --cycles
+std::string period_report(size_t period, std::uint64_t generation) {
+  if (period == 1)
+    return "STILL LIFE - Unchanged since generation " +
+           std::to_string(generation - 1);
+  return "OSCILLATOR - Period " + std::to_string(period) +
+         " since generation " + std::to_string(generation - period);
+}
 
-  for (size_t i = 0; i < number_of_cells; ++i) {
-    board[random_number(rng)][random_number(rng)] = Cell::alive;
+/// Generation handed by the simulation thread to the render thread
+template <typename Grid> struct Frame {
+  Grid board;
+  std::uint64_t generation = 0;
+  size_t population = 0;
+  DensityMap density; ///< Populations of the tiles, only for --view
+
+  /// Counts the living cells of the tiles of the board, if --view needs them
+  void map_density(ViewMode view) {
+    if (view != ViewMode::cells)
+      density.build(board);
   }
+};
+
+/// Status line drawn below a board
+std::string status_line(std::uint64_t generation, size_t population) {
+  return "Generation " + std::to_string(generation) + ": " +
+         std::to_string(population) + " living cells";
 }
 
-void print_board(const Board &board) {
+/// Keeps a loop to a number of iterations per second, or none for 0
+class Pacer {
+public:
+  explicit Pacer(double rate)
+      : period(rate > 0 ? 1 / rate : 0),
+        next(std::chrono::steady_clock::now()) {}
+
+  /// Waits for the next iteration, without catching up after a slow one
+  void wait() {
+    if (period.count() == 0)
+      return;
+    next = std::max(next + std::chrono::duration_cast<
+                               std::chrono::steady_clock::duration>(period),
+                    std::chrono::steady_clock::now());
+    std::this_thread::sleep_until(next);
+  }
+
+private:
+  std::chrono::duration<double> period;
+  std::chrono::steady_clock::time_point next;
+};
 
-  std::system("clear");
-  std::for_each(board.begin(), board.end(), [](const Row &row) {
-    std::for_each(row.begin(), row.end(), [&](Cell cell) {
-      std::cout << (cell == Cell::alive ? ALIVE_SYMBOL : DEAD_SYMBOL);
-    });
-    std::cout << std::endl;
+/**
+ * Draws the frames of a game: the whole board with TerminalRenderer, or the
+ * viewport of --view, steered by the keys typed on the terminal meanwhile.
+ */
+class Display {
+public:
+  explicit Display(const GameOptions &options)
+      : mode(options.view), view(options.viewport), fit(options.fit_view),
+        viewport(options.view == ViewMode::cells ? ViewMode::braille
+                                                 : options.view) {
+    if (mode != ViewMode::cells)
+      input.reset(new TerminalInput);
+  }
+
+  template <typename Grid> void draw(const Frame<Grid> &frame) {
+    const std::string status =
+        status_line(frame.generation, frame.population);
+    if (mode == ViewMode::cells) {
+      cells.render(frame.board, status);
+      return;
+    }
+    width = frame.board.width();
+    height = frame.board.height();
+    if (fit) {
+      size_t dot_columns, dot_rows;
+      viewport.dots(dot_columns, dot_rows);
+      view.zoom = fit_zoom(width, height, dot_columns, dot_rows);
+      fit = false;
+    }
+    viewport.render(frame.board, frame.density, view, status);
+  }
+
+  /// Pans and zooms by the keys typed since the last call
+  bool steer() {
+    if (!input)
+      return false;
+    size_t dot_columns, dot_rows;
+    viewport.dots(dot_columns, dot_rows);
+    bool steered = false;
+    for (int key = input->read_key(); key != NO_KEY; key = input->read_key())
+      steered |=
+          steer_viewport(view, key, width, height, dot_columns, dot_rows);
+    return steered;
+  }
+
+private:
+  ViewMode mode;
+  Viewport view;
+  bool fit;
+  size_t width = 0, height = 0; ///< Size of the last board drawn
+  TerminalRenderer cells;
+  ViewportRenderer viewport;
+  std::unique_ptr<TerminalInput> input;
+};
+
+/**
+ * Plays a game with the simulation on a thread of its own, while the calling
+ * thread draws the last frame it offered at --fps.
+ *
+ * The simulation gets a function offer(fill) and calls it after the
+ * generations it may show: fill(Frame &) is only called to copy the board
+ * when the renderer took the previous frame, so a fast game is not slowed
+ * down by copies nobody draws.
+ *
+ * @param first Frame of the initial board, drawn before the game starts.
+ * @param simulate Function playing the game to its end given offer.
+ * @throws the errors of the simulation, once it is over.
+ */
+template <typename Grid, typename Simulate>
+void play_pipelined(Display &display, const GameOptions &options,
+                    const Frame<Grid> &first, Simulate simulate) {
+  display.draw(first);
+  TripleBuffer<Frame<Grid>> frames(first);
+  std::atomic<bool> finished{false};
+  std::exception_ptr error;
+  std::thread simulation([&] {
+    try {
+      simulate([&](auto fill) {
+        if (!frames.consumed())
+          return;
+        PROFILE_SCOPE("publish");
+        fill(frames.back());
+        frames.publish();
+      });
+    } catch (...) {
+      error = std::current_exception();
+    }
+    finished = true;
   });
+
+  Pacer pacer(options.frames_per_second);
+  while (!finished) {
+    const bool fresh = frames.update();
+    // A view moved by a key is drawn again even if no frame came meanwhile.
+    const bool steered = display.steer();
+    if (fresh || steered)
+      display.draw(frames.front());
+    pacer.wait();
+  }
+  simulation.join();
+  if (error)
+    std::rethrow_exception(error);
 }
 
-std::pair<int, int> neighbour_position(const std::vector<int> &coord,
-                                       const std::vector<size_t> positions,
-                                       size_t board_size) {
+template <typename Grid> void play(const GameOptions &options) {
+  World<Grid> world(options.width, options.height, options.threads,
+                    options.schedule, options.huge_pages);
+  Display display(options);
+  std::unique_ptr<SnapshotWriter> snapshots(
+      options.snapshot_path.empty()
+          ? nullptr
+          : new SnapshotWriter(options.snapshot_path));
+  std::unique_ptr<CycleDetector> cycles = cycle_detector(options);
+  std::uint64_t generations = start_game(world.edit_board(), options);
+  size_t period = 0;
+
+  if (cycles)
+    cycles->reset(world.board());
+  const std::uint64_t last_generation = generations + options.max_generations;
+  Frame<Grid> first{world.board(), generations, world.population()};
+  first.map_density(options.view);
+  play_pipelined(
+      display, options, first, [&](auto offer) {
+        Pacer pacer(options.generations_per_second);
+        while (world.population() > 0 && generations < last_generation &&
+               period == 0) {
+          PROFILE_GENERATION(generations);
+          {
+            PROFILE_SCOPE("step");
+            world.step();
+          }
+          generations++;
+          period = detect_cycle(cycles.get(), world);
+          {
+            PROFILE_SCOPE("checkpoint");
+            save_checkpoint(snapshots.get(), options, world.board(),
+                            generations, false);
+          }
+          if (generations % options.frame_skip == 0)
+            offer([&](Frame<Grid> &frame) {
+              world.read(frame.board);
+              frame.generation = generations;
+              frame.population = world.population();
+              frame.map_density(options.view);
+            });
+          PROFILE_SCOPE("sleep");
+          pacer.wait();
+        }
+      });
+  Frame<Grid> last{world.board(), generations, world.population()};
+  last.map_density(options.view);
+  display.draw(last);
+  save_checkpoint(snapshots.get(), options, world.board(), generations, true);
+  if (period)
+    std::cout << period_report(period, generations) << '\n';
+  else if (generations < last_generation)
+    std::cout << "GAME OVER - No Cells Alive\n";
+  else
+    std::cout << generations << " generations\n";
+}
 
-  int new_coords[2];
+template <typename Grid> void benchmark(const GameOptions &options) {
+  World<Grid> world(options.width, options.height, options.threads,
+                    options.schedule, options.huge_pages);
+  std::unique_ptr<SnapshotWriter> snapshots(
+      options.snapshot_path.empty()
+          ? nullptr
+          : new SnapshotWriter(options.snapshot_path));
+  std::unique_ptr<CycleDetector> cycles = cycle_detector(options);
+  std::unique_ptr<FrameExporter> exporter = frame_exporter(options);
+  size_t generations = 0;
+  size_t period = 0;
 
-  for (int i = 0; i < 2; ++i) {
-    new_coords[i] = positions[i] + coord[i];
-    if (new_coords[i] < 0 || new_coords[i] >= board_size) {
-      new_coords[i] = new_coords[i] < 0 ? board_size - 1 : 0;
+  const std::uint64_t first_generation =
+      start_game(world.edit_board(), options);
+  if (cycles)
+    cycles->reset(world.board());
+  if (exporter)
+    exporter->write(world.board(), first_generation);
+  const auto start = std::chrono::steady_clock::now();
+  while (world.population() > 0 && generations < options.max_generations &&
+         period == 0) {
+    PROFILE_GENERATION(first_generation + generations);
+    {
+      PROFILE_SCOPE("step");
+      world.step();
     }
+    generations++;
+    period = detect_cycle(cycles.get(), world);
+    if (exporter && generations % options.frame_skip == 0)
+      exporter->write(world.board(), first_generation + generations);
+    PROFILE_SCOPE("checkpoint");
+    save_checkpoint(snapshots.get(), options, world.board(),
+                    first_generation + generations, false);
   }
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  save_checkpoint(snapshots.get(), options, world.board(),
+                  first_generation + generations, true);
+  if (exporter)
+    exporter->finish();
+
+  const double cells = double(options.width) * double(options.height);
+  const double generations_per_second =
+      seconds > 0 ? generations / seconds : 0;
+  const double cell_updates_per_second = generations_per_second * cells;
+  const std::string stepper =
+      options.engine == Engine::naive
+          ? "naive"
+          : std::string("packed-") + packed_kernel().name;
+  const char *schedule =
+      options.schedule == Schedule::tiles ? "tiles" : "bands";
+  std::ostream &report = report_stream(options);
 
-  return std::make_pair(new_coords[0], new_coords[1]);
+  if (options.json) {
+    report << "{\"width\": " << options.width
+              << ", \"height\": " << options.height
+              << ", \"engine\": \"" << engine_string(options.engine) << "\""
+              << ", \"stepper\": \"" << stepper << "\""
+              << ", \"rule\": \"" << rule_string(selected_rule()) << "\""
+              << ", \"threads\": " << options.threads
+              << ", \"schedule\": \"" << schedule << "\""
+              << ", \"seed\": " << options.seed
+              << ", \"generations\": " << generations
+              << ", \"population\": " << world.population()
+              << ", \"period\": " << period
+              << ", \"wall_time_s\": " << seconds
+              << ", \"generations_per_s\": " << generations_per_second
+              << ", \"cell_updates_per_s\": " << cell_updates_per_second
+              << placement_report(world.placement(), true)
+              << export_report(exporter.get(), options, true) << "}\n";
+  } else {
+    report << options.width << "x" << options.height << " " << stepper
+              << " " << rule_string(selected_rule()) << ", " << options.threads
+              << " thread(s), " << schedule << ", seed " << options.seed
+              << "\n"
+              << generations << " generations in " << seconds << " s\n"
+              << generations_per_second << " generations/s\n"
+              << cell_updates_per_second << " cell updates/s\n"
+              << world.population() << " living cells\n"
+              << placement_report(world.placement(), false) << "\n"
+              << export_report(exporter.get(), options, false);
+    if (period)
+      report << period_report(period, first_generation + generations) << '\n';
+  }
 }
 
-void update_board(Board &board) {
-  const std::vector<std::vector<int>> neighbourhood{
-      {-1, 0}, {0, -1}, {1, 0}, {0, 1}, {1, 1}, {-1, -1}, {-1, 1}, {1, -1}};
-  Board temp_board = board_factory(board.size());
-  uint count_neighbors;
-  std::pair<int, int> pos;
-
-  for (size_t i = 0; i < board.size(); ++i) {
-    for (size_t j = 0; j < board.size(); ++j) {
-      count_neighbors = 0;
-      std::for_each(neighbourhood.begin(), neighbourhood.end(),
-                    [&](std::vector<int> neighbor) {
-                      pos = neighbour_position(
-                          neighbor, std::vector<size_t>{i, j}, board.size());
-                      if (board[pos.first][pos.second] == Cell::alive)
-                        count_neighbors++;
-                    });
-
-      if (board[i][j] == Cell::alive && count_neighbors < MIN_NEIGHBOURS) {
-        temp_board[i][j] = Cell::dead;
-      } else if (board[i][j] == Cell::alive &&
-                 count_neighbors >= MIN_NEIGHBOURS and
-                 count_neighbors <= MAX_NEIGHBOURS) {
-        temp_board[i][j] = Cell::alive;
-      } else if (board[i][j] == Cell::alive &&
-                 count_neighbors > MAX_NEIGHBOURS) {
-        temp_board[i][j] = Cell::dead;
-      } else if (board[i][j] == Cell::dead &&
-                 count_neighbors == MAX_NEIGHBOURS) {
-        temp_board[i][j] = Cell::alive;
-      }
-    }
+void batch(const GameOptions &options) {
+  EnsembleSettings settings;
+  settings.width = options.width;
+  settings.height = options.height;
+  settings.living_cells = options.living_cells;
+  settings.density = options.density;
+  settings.first_seed = options.seed;
+  settings.runs = options.batch_runs;
+  settings.max_generations = options.max_generations;
+  if (options.max_period)
+    settings.max_period = options.max_period;
+  settings.threads = options.threads;
+  settings.packed = options.engine != Engine::naive;
+
+  std::ofstream file;
+  if (options.csv_path != "-") {
+    file.open(options.csv_path);
+    if (!file)
+      throw std::runtime_error(options.csv_path + ": cannot write the CSV");
   }
-  board = std::move(temp_board);
+  const auto start = std::chrono::steady_clock::now();
+  run_ensemble(settings, file.is_open() ? file : std::cout);
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  if (file.is_open() && !file.flush())
+    throw std::runtime_error(options.csv_path + ": cannot write the CSV");
+
+  // The summary goes to the standard error, leaving the CSV alone on the
+  // standard output.
+  std::cerr << settings.runs << " boards from seed " << settings.first_seed
+            << " in " << seconds << " s, "
+            << (seconds > 0 ? settings.runs / seconds : 0) << " boards/s\n";
+}
+
+/// Name of the engine and size of its memory, for the headless reports
+const char *engine_name(const HashLife &) { return "hashlife"; }
+const char *engine_name(const SparseWorld &) { return "sparse"; }
+const char *engine_name(const GpuWorld &) { return "gpu"; }
+
+std::string memory_report(const HashLife &universe, bool json) {
+  if (json)
+    return ", \"nodes\": " + std::to_string(universe.node_count()) +
+           ", \"collections\": " + std::to_string(universe.collections());
+  return std::to_string(universe.node_count()) + " nodes, " +
+         std::to_string(universe.collections()) + " collection(s)";
 }
 
-bool is_everybody_dead(const Board &board) {
-  for (const Row &row : board) {
-    for (const Cell &cell : row) {
-      if (cell == Cell::alive)
-        return false;
+std::string memory_report(const SparseWorld &universe, bool json) {
+  if (json)
+    return ", \"chunks\": " + std::to_string(universe.chunk_count());
+  return std::to_string(universe.chunk_count()) + " chunks";
+}
+
+std::string memory_report(const GpuWorld &universe, bool json) {
+  if (json)
+    return ", \"device\": \"" + universe.device_name() + "\"";
+  return "on " + universe.device_name();
+}
+
+/**
+ * Writes the snapshots of -o from an engine, reading its board back only when
+ * one is due. Only the torus of -g takes -o.
+ */
+template <typename Universe>
+void save_plane_checkpoint(SnapshotWriter *snapshots,
+                           const GameOptions &options,
+                           const Universe &universe, bool last) {
+  if (!snapshots ||
+      !(last || (options.snapshot_interval &&
+                 universe.generation() % options.snapshot_interval == 0)))
+    return;
+  PackedBoard board(options.width, options.height);
+  universe.read(board);
+  save_checkpoint(snapshots, options, board, universe.generation(), last);
+}
+
+template <typename Universe>
+void play_plane(Universe &universe, const GameOptions &options) {
+  Board board(options.width, options.height);
+  Display display(options);
+  std::unique_ptr<SnapshotWriter> snapshots(
+      options.snapshot_path.empty()
+          ? nullptr
+          : new SnapshotWriter(options.snapshot_path));
+  const std::uint64_t step = std::uint64_t(1) << options.step_exponent;
+
+  start_game(board, options);
+  universe.load(board);
+  Frame<Board> first{board, universe.generation(), universe.population()};
+  first.map_density(options.view);
+  play_pipelined(
+      display, options, first, [&](auto offer) {
+        Pacer pacer(options.generations_per_second);
+        size_t steps = 0;
+        while (universe.population() > 0 &&
+               universe.generation() < options.max_generations) {
+          PROFILE_GENERATION(universe.generation());
+          {
+            PROFILE_SCOPE("step");
+            universe.step(std::min<std::uint64_t>(
+                step, options.max_generations - universe.generation()));
+          }
+          {
+            PROFILE_SCOPE("checkpoint");
+            save_plane_checkpoint(snapshots.get(), options, universe, false);
+          }
+          if (++steps % options.frame_skip == 0)
+            offer([&](Frame<Board> &frame) {
+              universe.read(frame.board);
+              frame.generation = universe.generation();
+              frame.population = universe.population();
+              frame.map_density(options.view);
+            });
+          PROFILE_SCOPE("sleep");
+          pacer.wait();
+        }
+      });
+  universe.read(board);
+  Frame<Board> last{board, universe.generation(), universe.population()};
+  last.map_density(options.view);
+  display.draw(last);
+  save_plane_checkpoint(snapshots.get(), options, universe, true);
+  if (universe.population() == 0)
+    std::cout << "GAME OVER - No Cells Alive\n";
+  else
+    std::cout << universe.generation() << " generations\n";
+}
+
+template <typename Universe>
+void benchmark_plane(Universe &universe, const GameOptions &options) {
+  Board board(options.width, options.height);
+  std::unique_ptr<SnapshotWriter> snapshots(
+      options.snapshot_path.empty()
+          ? nullptr
+          : new SnapshotWriter(options.snapshot_path));
+  std::unique_ptr<FrameExporter> exporter = frame_exporter(options);
+  const std::uint64_t step = std::uint64_t(1) << options.step_exponent;
+
+  start_game(board, options);
+  universe.load(board);
+  if (exporter)
+    exporter->write(board, universe.generation());
+  const auto start = std::chrono::steady_clock::now();
+  size_t steps = 0;
+  while (universe.population() > 0 &&
+         universe.generation() < options.max_generations) {
+    PROFILE_GENERATION(universe.generation());
+    {
+      PROFILE_SCOPE("step");
+      universe.step(std::min<std::uint64_t>(
+          step, options.max_generations - universe.generation()));
+    }
+    if (exporter && ++steps % options.frame_skip == 0) {
+      universe.read(board);
+      exporter->write(board, universe.generation());
     }
+    PROFILE_SCOPE("checkpoint");
+    save_plane_checkpoint(snapshots.get(), options, universe, false);
   }
-  return true;
-}
\ No newline at end of file
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  save_plane_checkpoint(snapshots.get(), options, universe, true);
+  if (exporter)
+    exporter->finish();
+
+  const double generations_per_second =
+      seconds > 0 ? universe.generation() / seconds : 0;
+  std::ostream &report = report_stream(options);
+
+  if (options.json) {
+    report << "{\"width\": " << options.width
+              << ", \"height\": " << options.height
+              << ", \"engine\": \"" << engine_string(options.engine) << "\""
+              << ", \"stepper\": \"" << engine_name(universe) << "\""
+              << ", \"rule\": \"" << rule_string(selected_rule()) << "\""
+              << ", \"step_exponent\": " << options.step_exponent
+              << ", \"seed\": " << options.seed
+              << ", \"generations\": " << universe.generation()
+              << ", \"population\": " << universe.population()
+              << ", \"wall_time_s\": " << seconds
+              << ", \"generations_per_s\": " << generations_per_second
+              << memory_report(universe, true)
+              << export_report(exporter.get(), options, true) << "}\n";
+  } else {
+    report << options.width << "x" << options.height << " "
+              << engine_name(universe) << " " << rule_string(selected_rule())
+              << ", 2^" << options.step_exponent
+              << " generations per step, seed " << options.seed << "\n"
+              << universe.generation() << " generations in " << seconds
+              << " s\n"
+              << generations_per_second << " generations/s\n"
+              << universe.population() << " living cells\n"
+              << memory_report(universe, false) << "\n"
+              << export_report(exporter.get(), options, false);
+  }
+}
@@ -0,0 +1,259 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file implements the distributed game of life, stepping a board split
+ * between the ranks of MPI_COMM_WORLD with no rendering, to run boards larger
+ * than the memory of a node.
+ *
+ * Basic build instructions
+ *
+ * compile: make mpi (needs an MPI implementation providing mpicxx)
+ * run it: mpirun -np 4 ./main_mpi -s 65536 -m 1000
+ *
+ * Usage
+ *
+ * The flags are a subset of those of main, with the same meaning:
+ *  -s sets the size of the board, either square or as width x height. The
+ *     width must be a multiple of 64
+ *  -n sets the initial number of living cells, placed at random
+ *  --density sets the probability of each initial cell to be alive instead
+ *  --seed sets the seed of the random cells. The same seed gives the same
+ *     cells as main with any number of ranks
+ *  -m sets the number of generations
+ *  -r sets the rule in B/S notation, Conway's B3/S23 by default
+ *  -i restores the board, the generation and the rule of a snapshot
+ *  -o writes a snapshot of the board to a file at the end of the game
+ *  -c writes the snapshots of -o every given number of generations too
+ *  -j prints the report as JSON
+ *  --halo sets the depth of the halos, the number of generations the ranks
+ *     advance between two exchanges, 1 by default. Deeper halos send fewer
+ *     messages and recompute more cells, see mpi_world.h
+ *      mpirun -np 16 ./main_mpi -s 262144 -m 100 -o big.snap -j
+ *      mpirun -np 64 ./main_mpi -s 65536 -m 1000 --halo 8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#include "mpi_world.h"
+
+#include <getopt.h>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+/// Settings of a distributed game
+struct DistributedOptions {
+  size_t width = 4096;          ///< Number of columns of the board
+  size_t height = 4096;         ///< Number of rows of the board
+  size_t living_cells = 0;      ///< Initial number of living cells
+  double density = 0.3;         ///< Probability of a living cell, without -n
+  std::uint64_t seed = 0;       ///< Seed of the random cells
+  size_t max_generations = 100; ///< Number of generations
+  bool json = false;            ///< Whether to print the report as JSON
+  std::string restore_path;     ///< Snapshot restored by -i, if any
+  std::string snapshot_path;    ///< File receiving the snapshots of -o
+  size_t snapshot_interval = 0; ///< Generations between two snapshots, or 0
+  size_t halo_depth = 1;        ///< Generations between two halo exchanges
+};
+
+/// Values returned by getopt_long for the options without a short name
+enum LongOption { SEED_OPTION = 256, DENSITY_OPTION, HALO_OPTION };
+
+/**
+ * Reads the flags of the command line, the same on every rank.
+ *
+ * @return bool false if a flag is invalid.
+ */
+bool parse_options(int argc, char **argv, DistributedOptions &options,
+                   bool &seeded) {
+  const option long_options[] = {
+      {"seed", required_argument, nullptr, SEED_OPTION},
+      {"density", required_argument, nullptr, DENSITY_OPTION},
+      {"halo", required_argument, nullptr, HALO_OPTION},
+      {nullptr, 0, nullptr, 0}};
+
+  while (true) {
+    switch (getopt_long(argc, argv, "s:n:m:r:i:o:c:j", long_options,
+                        nullptr)) {
+    case 's': {
+      const std::string size(optarg);
+      const size_t separator = size.find('x');
+      options.width = std::stoull(size.substr(0, separator));
+      options.height = separator == std::string::npos
+                           ? options.width
+                           : std::stoull(size.substr(separator + 1));
+      continue;
+    }
+    case 'n':
+      options.living_cells = std::stoull(optarg);
+      options.density = 0;
+      continue;
+    case DENSITY_OPTION:
+      options.density = std::stod(optarg);
+      continue;
+    case SEED_OPTION:
+      options.seed = std::stoull(optarg, nullptr, 0);
+      seeded = true;
+      continue;
+    case HALO_OPTION:
+      options.halo_depth = std::stoull(optarg);
+      if (options.halo_depth == 0)
+        return false;
+      continue;
+    case 'm':
+      options.max_generations = std::stoull(optarg);
+      continue;
+    case 'r': {
+      Rule rule;
+      if (!parse_rule(optarg, rule))
+        return false;
+      select_rule(rule);
+      continue;
+    }
+    case 'i':
+      options.restore_path = optarg;
+      continue;
+    case 'o':
+      options.snapshot_path = optarg;
+      continue;
+    case 'c':
+      options.snapshot_interval = std::stoull(optarg);
+      continue;
+    case 'j':
+      options.json = true;
+      continue;
+    case -1:
+      return true;
+    default:
+      return false;
+    }
+  }
+}
+
+/// Plays the game, returning the exit status of the rank
+int play(DistributedOptions &options) {
+  int rank, ranks;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+  std::uint64_t generation = 0;
+  if (!options.restore_path.empty()) {
+    // Every rank maps the snapshot for its size; only the header is read.
+    const Snapshot snapshot = load_snapshot(options.restore_path, false);
+    options.width = snapshot.board.width();
+    options.height = snapshot.board.height();
+  }
+
+  DistributedWorld world(MPI_COMM_WORLD, options.width, options.height,
+                         options.halo_depth);
+  if (!options.restore_path.empty()) {
+    const Snapshot snapshot = world.restore(options.restore_path);
+    generation = snapshot.generation;
+    select_rule(snapshot.rule);
+  } else if (options.density > 0) {
+    world.generates_random_state(options.density, options.seed);
+  } else {
+    world.generates_initial_state(options.living_cells, options.seed);
+  }
+
+  const std::uint64_t first_generation = generation;
+  const std::uint64_t last_generation =
+      first_generation + options.max_generations;
+  MPI_Barrier(MPI_COMM_WORLD);
+  const double start = MPI_Wtime();
+  while (generation < last_generation) {
+    world.step();
+    generation++;
+    if (!options.snapshot_path.empty() && options.snapshot_interval &&
+        generation % options.snapshot_interval == 0 &&
+        generation < last_generation)
+      world.save(options.snapshot_path, generation, selected_rule());
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  const double seconds = MPI_Wtime() - start;
+  if (!options.snapshot_path.empty())
+    world.save(options.snapshot_path, generation, selected_rule());
+  const size_t population = world.population();
+
+  if (rank != 0)
+    return 0;
+  const double generations = double(generation - first_generation);
+  const double generations_per_second =
+      seconds > 0 ? generations / seconds : 0;
+  const double cell_updates_per_second =
+      generations_per_second * double(options.width) * double(options.height);
+  const std::string stepper = std::string("mpi-") + packed_kernel().name;
+  if (options.json) {
+    std::cout << "{\"width\": " << options.width
+              << ", \"height\": " << options.height << ", \"stepper\": \""
+              << stepper << "\""
+              << ", \"rule\": \"" << rule_string(selected_rule()) << "\""
+              << ", \"ranks\": " << ranks
+              << ", \"grid\": \"" << world.dimensions()[0] << "x"
+              << world.dimensions()[1] << "\""
+              << ", \"halo\": " << world.halo_depth()
+              << ", \"seed\": " << options.seed
+              << ", \"generations\": " << generation - first_generation
+              << ", \"population\": " << population
+              << ", \"wall_time_s\": " << seconds
+              << ", \"generations_per_s\": " << generations_per_second
+              << ", \"cell_updates_per_s\": " << cell_updates_per_second
+              << "}\n";
+  } else {
+    std::cout << options.width << "x" << options.height << " " << stepper
+              << " " << rule_string(selected_rule()) << ", " << ranks
+              << " rank(s) in a " << world.dimensions()[0] << "x"
+              << world.dimensions()[1] << " grid, halo of depth "
+              << world.halo_depth() << ", seed " << options.seed << "\n"
+              << generation - first_generation << " generations in "
+              << seconds << " s\n"
+              << generations_per_second << " generations/s\n"
+              << cell_updates_per_second << " cell updates/s\n"
+              << population << " living cells\n";
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  MPI_Init(&argc, &argv);
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  DistributedOptions options;
+  bool seeded = false;
+  int status = 0;
+  if (!parse_options(argc, argv, options, seeded)) {
+    if (rank == 0)
+      std::cerr << "Invalid flags, see the usage in mpi_main.cpp\n";
+    status = 1;
+  } else {
+    // The ranks must draw the same cells.
+    if (!seeded && rank == 0)
+      options.seed = random_seed();
+    MPI_Bcast(&options.seed, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+    try {
+      status = play(options);
+    } catch (const std::runtime_error &error) {
+      if (rank == 0)
+        std::cerr << error.what() << '\n';
+      status = 1;
+    }
+  }
+  MPI_Finalize();
+  return status;
+}
@@ -0,0 +1,355 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file implements the distributed world declared in mpi_world.h.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#include "mpi_world.h"
+
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+/*
+    Implementations
+*/
+
+/// Offsets of the neighbouring blocks, clockwise from the north
+static const int ROW_OFFSETS[8] = {-1, -1, 0, 1, 1, 1, 0, -1};
+static const int COLUMN_OFFSETS[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+
+/// Rows of the board sent to rank 0 at once by save
+const size_t SAVE_ROWS = 256;
+
+/// Draws for the exact count tried between two reductions
+const size_t FLIP_BATCH = 4096;
+
+/// Start of part index of a range split in parts ranges
+static size_t split(size_t range, int parts, int index) {
+  return range * index / parts;
+}
+
+DistributedWorld::DistributedWorld(MPI_Comm parent, size_t width,
+                                   size_t height, size_t depth)
+    : board_width(width), board_height(height), depth(depth),
+      halo_words(1 + (depth + PackedBoard::WORD_BITS - 2) /
+                         PackedBoard::WORD_BITS) {
+  int size;
+  MPI_Comm_size(parent, &size);
+  MPI_Dims_create(size, 2, grid_dimensions);
+  if (width == 0 || width % PackedBoard::WORD_BITS != 0)
+    throw std::runtime_error("the width of a distributed board must be a "
+                             "multiple of 64");
+  if (width / PackedBoard::WORD_BITS < size_t(grid_dimensions[1]) ||
+      height < size_t(grid_dimensions[0]))
+    throw std::runtime_error("the board is too small for " +
+                             std::to_string(size) + " ranks");
+  // The halos come from the blocks next to this one only.
+  if (depth == 0 ||
+      height / grid_dimensions[0] < depth ||
+      width / PackedBoard::WORD_BITS / grid_dimensions[1] < halo_words)
+    throw std::runtime_error("the blocks of " + std::to_string(size) +
+                             " ranks are too small for a halo of depth " +
+                             std::to_string(depth));
+
+  const int periods[2] = {1, 1};
+  MPI_Cart_create(parent, 2, grid_dimensions, periods, 0, &communicator);
+  MPI_Comm_rank(communicator, &my_rank);
+  MPI_Cart_coords(communicator, my_rank, 2, coordinates);
+  for (int d = 0; d < 8; ++d) {
+    const int around[2] = {
+        (coordinates[0] + ROW_OFFSETS[d] + grid_dimensions[0]) %
+            grid_dimensions[0],
+        (coordinates[1] + COLUMN_OFFSETS[d] + grid_dimensions[1]) %
+            grid_dimensions[1]};
+    MPI_Cart_rank(communicator, around, &neighbours[d]);
+  }
+
+  const size_t board_words = width / PackedBoard::WORD_BITS;
+  first_row = split(height, grid_dimensions[0], coordinates[0]);
+  rows = split(height, grid_dimensions[0], coordinates[0] + 1) - first_row;
+  first_word = split(board_words, grid_dimensions[1], coordinates[1]);
+  words =
+      split(board_words, grid_dimensions[1], coordinates[1] + 1) - first_word;
+  stride = words + 2 * halo_words;
+  current.assign((rows + 2 * depth) * stride, 0);
+  next.assign((rows + 2 * depth) * stride, 0);
+
+  MPI_Type_vector(depth, words, stride, MPI_UINT64_T, &row_type);
+  MPI_Type_vector(rows, halo_words, stride, MPI_UINT64_T, &column_type);
+  MPI_Type_vector(depth, halo_words, stride, MPI_UINT64_T, &corner_type);
+  MPI_Type_commit(&row_type);
+  MPI_Type_commit(&column_type);
+  MPI_Type_commit(&corner_type);
+}
+
+DistributedWorld::~DistributedWorld() {
+  MPI_Type_free(&row_type);
+  MPI_Type_free(&column_type);
+  MPI_Type_free(&corner_type);
+  MPI_Comm_free(&communicator);
+}
+
+void DistributedWorld::agree(bool failed, const std::string &message) const {
+  int any_failed = failed;
+  MPI_Allreduce(MPI_IN_PLACE, &any_failed, 1, MPI_INT, MPI_LOR, communicator);
+  if (any_failed)
+    throw std::runtime_error(failed ? message : "failed on another rank");
+}
+
+size_t DistributedWorld::fill_random_cells(std::uint64_t threshold,
+                                           std::uint64_t seed) {
+  const size_t board_words = board_width / PackedBoard::WORD_BITS;
+  size_t population = 0;
+  for (size_t i = 0; i < rows; ++i) {
+    const std::uint64_t first_index = (first_row + i) * board_words + first_word;
+    Word *cells = row(current, depth + i) + halo_words;
+    for (size_t k = 0; k < words; ++k) {
+      cells[k] = random_cells(seed, first_index + k, threshold);
+      population += __builtin_popcountll(cells[k]);
+    }
+  }
+  phase = 0;
+  return population;
+}
+
+void DistributedWorld::generates_random_state(double density,
+                                              std::uint64_t seed) {
+  fill_random_cells(random_density_threshold(density), seed);
+}
+
+void DistributedWorld::generates_initial_state(size_t number_of_cells,
+                                               std::uint64_t seed) {
+  const size_t cells = board_width * board_height;
+  number_of_cells = std::min(number_of_cells, cells);
+  std::uint64_t population =
+      fill_random_cells(random_count_threshold(number_of_cells, cells), seed);
+  MPI_Allreduce(MPI_IN_PLACE, &population, 1, MPI_UINT64_T, MPI_SUM,
+                communicator);
+
+  // The draws of generates_board_initial_state are replayed by every rank in
+  // batches. Each rank flips the drawn cells it owns, and the reduced flags of
+  // the batch tell where the count is reached: flips past it are undone, as
+  // the single board never makes them.
+  const bool adding = population < number_of_cells;
+  std::vector<std::uint64_t> flipped(FLIP_BATCH / 64);
+  std::vector<std::pair<size_t, size_t>> owned_flips; // draw, cell
+  for (std::uint64_t draw = 0; population != number_of_cells;
+       draw += FLIP_BATCH) {
+    std::fill(flipped.begin(), flipped.end(), 0);
+    owned_flips.clear();
+    for (size_t b = 0; b < FLIP_BATCH; ++b) {
+      const size_t cell = random_cell(seed, draw + b, cells);
+      const size_t i = cell / board_width, j = cell % board_width;
+      if (!owns(i, j))
+        continue;
+      const Word bit = Word(1) << (j % PackedBoard::WORD_BITS);
+      Word &word = word_at(i, j);
+      if (bool(word & bit) != adding) {
+        word ^= bit;
+        flipped[b / 64] |= std::uint64_t(1) << (b % 64);
+        owned_flips.emplace_back(b, cell);
+      }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, flipped.data(), flipped.size(), MPI_UINT64_T,
+                  MPI_BOR, communicator);
+
+    const size_t needed = adding ? number_of_cells - population
+                                 : population - number_of_cells;
+    size_t flips = 0, last_draw = FLIP_BATCH;
+    for (size_t b = 0; b < FLIP_BATCH && flips < needed; ++b) {
+      if ((flipped[b / 64] >> (b % 64)) & 1 && ++flips == needed)
+        last_draw = b;
+    }
+    for (const auto &flip : owned_flips) {
+      if (flip.first > last_draw)
+        word_at(flip.second / board_width, flip.second % board_width) ^=
+            Word(1) << (flip.second % board_width % PackedBoard::WORD_BITS);
+    }
+    if (adding)
+      population += flips;
+    else
+      population -= flips;
+  }
+}
+
+Snapshot DistributedWorld::restore(const std::string &path) {
+  Snapshot snapshot;
+  std::string message;
+  try {
+    snapshot = load_snapshot(path, my_rank == 0);
+    if (snapshot.board.width() != board_width ||
+        snapshot.board.height() != board_height)
+      message = path + ": the snapshot does not have the size of the board";
+  } catch (const std::runtime_error &error) {
+    message = error.what();
+  }
+  agree(!message.empty(), message);
+
+  // Only the pages of the block are read from the mapped file.
+  for (size_t i = 0; i < rows; ++i)
+    std::memcpy(row(current, depth + i) + halo_words,
+                snapshot.board.row(first_row + i) + first_word,
+                words * sizeof(Word));
+  snapshot.board = PackedBoard();
+  phase = 0;
+  return snapshot;
+}
+
+void DistributedWorld::save(const std::string &path, std::uint64_t generation,
+                            const Rule &rule) const {
+  const size_t board_words = board_width / PackedBoard::WORD_BITS;
+  std::unique_ptr<SnapshotStream> stream;
+  std::string message;
+  std::vector<Word> band, part;
+  if (my_rank == 0) {
+    try {
+      stream.reset(new SnapshotStream(path, board_width, board_height));
+    } catch (const std::runtime_error &error) {
+      message = error.what();
+    }
+    band.resize(SAVE_ROWS * board_words);
+  }
+
+  // Rank 0 keeps receiving after an error, so that no rank waits forever.
+  for (int r = 0; r < grid_dimensions[0]; ++r) {
+    const size_t band_end = split(board_height, grid_dimensions[0], r + 1);
+    for (size_t first = split(board_height, grid_dimensions[0], r);
+         first < band_end; first += SAVE_ROWS) {
+      const size_t count = std::min(SAVE_ROWS, band_end - first);
+      for (int c = 0; c < grid_dimensions[1]; ++c) {
+        const int position[2] = {r, c};
+        int source;
+        MPI_Cart_rank(communicator, position, &source);
+        const size_t part_first = split(board_words, grid_dimensions[1], c);
+        const size_t part_words =
+            split(board_words, grid_dimensions[1], c + 1) - part_first;
+        if (source == my_rank) {
+          part.resize(count * words);
+          for (size_t i = 0; i < count; ++i)
+            std::memcpy(part.data() + i * words,
+                        row(current, first - first_row + i + depth) +
+                            halo_words,
+                        words * sizeof(Word));
+          if (my_rank != 0)
+            MPI_Send(part.data(), part.size(), MPI_UINT64_T, 0, 0,
+                     communicator);
+        } else if (my_rank == 0) {
+          part.resize(count * part_words);
+          MPI_Recv(part.data(), part.size(), MPI_UINT64_T, source, 0,
+                   communicator, MPI_STATUS_IGNORE);
+        }
+        if (my_rank == 0) {
+          for (size_t i = 0; i < count; ++i)
+            std::memcpy(band.data() + i * board_words + part_first,
+                        part.data() + i * part_words,
+                        part_words * sizeof(Word));
+        }
+      }
+      if (stream && message.empty()) {
+        try {
+          stream->write(band.data(), count * board_words);
+        } catch (const std::runtime_error &error) {
+          message = error.what();
+        }
+      }
+    }
+  }
+
+  if (stream && message.empty()) {
+    try {
+      stream->finish(generation, rule);
+    } catch (const std::runtime_error &error) {
+      message = error.what();
+    }
+  }
+  agree(!message.empty(), message);
+}
+
+void DistributedWorld::update_row(size_t i, size_t begin, size_t end) {
+  packed_kernel().kernel(row(current, i - 1), row(current, i),
+                         row(current, i + 1), row(next, i), begin, end);
+}
+
+void DistributedWorld::post_exchange(MPI_Request *requests) {
+  // Message d travels in direction d: it carries the side of the block
+  // facing neighbour d, into the opposite halo of that neighbour.
+  for (int d = 0; d < 8; ++d) {
+    const int dr = ROW_OFFSETS[d], dc = COLUMN_OFFSETS[d];
+    const size_t send_row = dr > 0 ? rows : depth;
+    const size_t send_word = dc > 0 ? words : halo_words;
+    const size_t receive_row = dr < 0 ? depth + rows : dr > 0 ? 0 : depth;
+    const size_t receive_word = dc < 0   ? halo_words + words
+                                : dc > 0 ? 0
+                                         : halo_words;
+    const MPI_Datatype type = dc == 0   ? row_type
+                              : dr == 0 ? column_type
+                                        : corner_type;
+    MPI_Irecv(row(current, receive_row) + receive_word, 1, type,
+              neighbours[(d + 4) % 8], d, communicator, &requests[2 * d]);
+    MPI_Isend(row(current, send_row) + send_word, 1, type, neighbours[d], d,
+              communicator, &requests[2 * d + 1]);
+  }
+}
+
+void DistributedWorld::step() {
+  // Generation t after an exchange is valid up to t cells from the edge of
+  // the halos: rows closer than that are left behind. The outer word of the
+  // west and east halos is never updated, the row kernel needing the words
+  // on both sides, which is why the halos hold 63 more columns than depth.
+  const size_t first = phase + 1, last = rows + 2 * depth - phase - 1;
+  if (phase == 0) {
+    MPI_Request requests[16];
+    post_exchange(requests);
+
+    // The interior of the block reads none of the halos.
+    const bool interior = rows > 2 && words > 2;
+    if (interior) {
+      for (size_t i = depth + 1; i < depth + rows - 1; ++i)
+        update_row(i, halo_words + 1, halo_words + words - 1);
+    }
+
+    MPI_Waitall(16, requests, MPI_STATUSES_IGNORE);
+
+    for (size_t i = first; i < last; ++i) {
+      if (interior && i > depth && i < depth + rows - 1) {
+        update_row(i, 1, halo_words + 1);
+        update_row(i, halo_words + words - 1, stride - 1);
+      } else {
+        update_row(i, 1, stride - 1);
+      }
+    }
+  } else {
+    for (size_t i = first; i < last; ++i)
+      update_row(i, 1, stride - 1);
+  }
+  phase = (phase + 1) % depth;
+  std::swap(current, next);
+}
+
+size_t DistributedWorld::population() const {
+  std::uint64_t population = 0;
+  for (size_t i = depth; i < depth + rows; ++i)
+    population += count_living_cells(row(current, i) + halo_words,
+                                     row(current, i) + halo_words + words);
+  MPI_Allreduce(MPI_IN_PLACE, &population, 1, MPI_UINT64_T, MPI_SUM,
+                communicator);
+  return population;
+}
@@ -0,0 +1,173 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file declares the distributed world, splitting a packed torus into 2D
+ * blocks stepped by the ranks of an MPI communicator, so that the board only
+ * has to fit in the memory of all the nodes together.
+ *
+ * Each rank stores its block with a halo of k rows on the north and south
+ * and enough words on the west and east to hold k + 63 columns, filled from
+ * the eight neighbouring blocks. The halos are sent with non blocking
+ * messages while the rank updates the interior of its block, which needs
+ * none of them, and only the border of the block waits for their arrival.
+ *
+ * A halo of depth k lets a rank advance k generations between two
+ * exchanges: each generation the valid part of the halo shrinks by one cell,
+ * and the rank recomputes the cells of its neighbours it still holds instead
+ * of waiting for them. Deeper halos send k times fewer messages at the cost
+ * of that redundant work, which pays off when the latency between the nodes
+ * dominates the time of a generation.
+ *
+ * The blocks are whole words wide, so the width of the board must be a
+ * multiple of 64.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#ifndef MPI_WORLD_H
+#define MPI_WORLD_H
+
+#include "game_of_life.h"
+#include "snapshot.h"
+
+#include <mpi.h>
+
+/**
+ * Packed torus shared between the ranks of a communicator.
+ *
+ * Every member function is collective: all the ranks call it in the same
+ * order with the same arguments. Errors are thrown on every rank alike.
+ */
+class DistributedWorld {
+public:
+  typedef PackedBoard::Word Word;
+
+  /**
+   * Creates a dead board split between the ranks of communicator.
+   *
+   * @param communicator MPI_Comm whose ranks share the board.
+   * @param width size_t with the number of columns, a multiple of 64.
+   * @param height size_t with the number of rows.
+   * @param depth size_t with the number of generations between two halo
+   * exchanges, at least 1.
+   * @throws std::runtime_error if the board cannot be split between the
+   * ranks, or the blocks are thinner than the halo.
+   */
+  DistributedWorld(MPI_Comm communicator, size_t width, size_t height,
+                   size_t depth = 1);
+  ~DistributedWorld();
+
+  DistributedWorld(const DistributedWorld &) = delete;
+  DistributedWorld &operator=(const DistributedWorld &) = delete;
+
+  /// Number of columns of the whole board
+  size_t width() const { return board_width; }
+  /// Number of rows of the whole board
+  size_t height() const { return board_height; }
+  /// Rank of the calling process in the communicator of the world
+  int rank() const { return my_rank; }
+  /// Number of ranks along the rows and the columns of the board
+  const int *dimensions() const { return grid_dimensions; }
+  /// Number of generations between two halo exchanges
+  size_t halo_depth() const { return depth; }
+
+  /// Cells of generates_board_random_state on a whole board
+  void generates_random_state(double density, std::uint64_t seed);
+
+  /// Cells of generates_board_initial_state on a whole board
+  void generates_initial_state(size_t number_of_cells, std::uint64_t seed);
+
+  /**
+   * Loads the block of every rank from a snapshot, which all of them map.
+   *
+   * @param path const std::string with the path of the snapshot file,
+   * verified by the checksum on rank 0.
+   * @return Snapshot without board, with the generation and the rule.
+   * @throws std::runtime_error if the snapshot cannot be read or does not
+   * have the size of the world.
+   */
+  Snapshot restore(const std::string &path);
+
+  /**
+   * Writes a snapshot of the whole board from rank 0, which receives a few
+   * rows of the blocks at a time.
+   *
+   * @throws std::runtime_error if rank 0 cannot write the file.
+   */
+  void save(const std::string &path, std::uint64_t generation,
+            const Rule &rule) const;
+
+  /// Advances the board by one generation
+  void step();
+
+  /// Number of living cells of the whole board
+  size_t population() const;
+
+private:
+  /// First word of row i of a block, counting the north halo from row 0
+  Word *row(std::vector<Word> &cells, size_t i) {
+    return cells.data() + i * stride;
+  }
+  const Word *row(const std::vector<Word> &cells, size_t i) const {
+    return cells.data() + i * stride;
+  }
+
+  /// Whether cell j of row i of the board is in the block
+  bool owns(size_t i, size_t j) const {
+    return i >= first_row && i < first_row + rows &&
+           j / PackedBoard::WORD_BITS >= first_word &&
+           j / PackedBoard::WORD_BITS < first_word + words;
+  }
+  /// Word of the block holding the owned cell j of row i of the board
+  Word &word_at(size_t i, size_t j) {
+    return row(current, i - first_row + depth)[j / PackedBoard::WORD_BITS -
+                                               first_word + halo_words];
+  }
+
+  /// Updates words [begin, end) of row i of the block
+  void update_row(size_t i, size_t begin, size_t end);
+
+  /// Sends the sides of the block into the halos of its neighbours
+  void post_exchange(MPI_Request *requests);
+
+  /// Fills the block with random_cells, returning its population
+  size_t fill_random_cells(std::uint64_t threshold, std::uint64_t seed);
+
+  /// Throws on every rank the error of any of them
+  void agree(bool failed, const std::string &message) const;
+
+  MPI_Comm communicator = MPI_COMM_NULL; ///< Periodic 2D cartesian grid
+  int my_rank = 0;
+  int grid_dimensions[2] = {0, 0}; ///< Ranks along the rows and the columns
+  int coordinates[2] = {0, 0};     ///< Position of the block of this rank
+  int neighbours[8];               ///< Ranks of the blocks around, clockwise
+  MPI_Datatype row_type = MPI_DATATYPE_NULL;    ///< North or south side
+  MPI_Datatype column_type = MPI_DATATYPE_NULL; ///< West or east side
+  MPI_Datatype corner_type = MPI_DATATYPE_NULL; ///< Corner of the block
+
+  size_t board_width, board_height;
+  size_t first_row, rows;   ///< Rows of the board in the block
+  size_t first_word, words; ///< Words of each row in the block
+  size_t depth;             ///< Rows of the north and south halos
+  size_t halo_words;        ///< Words of the west and east halos
+  size_t stride;            ///< Words of each row, with the halos
+  size_t phase = 0;         ///< Generations since the last exchange
+  std::vector<Word> current, next;
+};
+
+#endif // MPI_WORLD_H
@@ -0,0 +1,382 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file implements the pattern loaders declared in patterns.h.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#include "patterns.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <unistd.h>
+
+/*
+    Implementations
+*/
+
+/// Number of bytes of a pattern file read at once
+const size_t PATTERN_CHUNK_SIZE = 1 << 20;
+
+/// Pattern file, or the standard input, read one chunk at a time
+class PatternFile {
+public:
+  explicit PatternFile(const std::string &path)
+      : path(path), buffer(PATTERN_CHUNK_SIZE) {
+    fd = path == "-" ? STDIN_FILENO : open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw std::runtime_error(path + ": cannot open the pattern: " +
+                               std::strerror(errno));
+  }
+  ~PatternFile() {
+    if (fd != STDIN_FILENO)
+      close(fd);
+  }
+
+  PatternFile(const PatternFile &) = delete;
+  PatternFile &operator=(const PatternFile &) = delete;
+
+  /// Reads the next chunk, returning false at the end of the file
+  bool next(const char *&begin, const char *&end) {
+    ssize_t result;
+    do
+      result = read(fd, buffer.data(), buffer.size());
+    while (result < 0 && errno == EINTR);
+    if (result < 0)
+      throw std::runtime_error(path + ": cannot read the pattern: " +
+                               std::strerror(errno));
+    begin = buffer.data();
+    end = begin + result;
+    return result > 0;
+  }
+
+private:
+  std::string path;
+  std::vector<char> buffer;
+  int fd;
+};
+
+/// Adds the living cells of columns [column, column + count) of a row
+static void add_run(Board &board, size_t row, size_t column, size_t count) {
+  std::fill(board.row(row) + column, board.row(row) + column + count,
+            Cell::alive);
+}
+
+static void add_run(PackedBoard &board, size_t row, size_t column,
+                    size_t count) {
+  typedef PackedBoard::Word Word;
+  Word *words = board.row(row);
+  while (count > 0) {
+    const size_t bit = column % PackedBoard::WORD_BITS;
+    const size_t bits = std::min(count, PackedBoard::WORD_BITS - bit);
+    const Word mask =
+        bits == PackedBoard::WORD_BITS ? ~Word(0) : (Word(1) << bits) - 1;
+    words[column / PackedBoard::WORD_BITS] |= mask << bit;
+    column += bits;
+    count -= bits;
+  }
+}
+
+/**
+ * Streaming parser of a pattern file.
+ *
+ * The parser keeps its state between chunks, so a chunk may end anywhere,
+ * even in the middle of a run count.
+ *
+ * @tparam Grid Board or PackedBoard receiving the cells. Without a board, only
+ * the header is read.
+ */
+template <typename Grid> class PatternParser {
+public:
+  PatternParser(Grid *board, size_t top, size_t left, PatternFormat format)
+      : board(board), top(top), left(left) {
+    info.format = format;
+  }
+
+  /**
+   * Parses a chunk of the file.
+   *
+   * @return bool false once the rest of the file is not needed.
+   */
+  bool feed(const char *begin, const char *end) {
+    for (const char *c = begin; c != end; ++c) {
+      switch (state) {
+      case State::line_start:
+        if (info.format == PatternFormat::rle) {
+          if (*c == '\n' || *c == '\r' || *c == ' ' || *c == '\t')
+            continue;
+          if (*c == '#') {
+            state = State::comment;
+            continue;
+          }
+          if (*c == 'x' && !body_started) {
+            state = State::header;
+            line.assign(1, *c);
+            continue;
+          }
+        } else if (*c == '!') {
+          state = State::comment;
+          continue;
+        }
+        if (!board)
+          return false;
+        body_started = true;
+        state = State::body;
+        if (!parse_cell(*c))
+          return false;
+        continue;
+      case State::comment:
+        if (*c == '\n')
+          state = body_started && info.format == PatternFormat::rle
+                      ? State::body
+                      : State::line_start;
+        continue;
+      case State::header:
+        if (*c != '\n') {
+          line += *c;
+          continue;
+        }
+        parse_header();
+        state = State::line_start;
+        if (!board)
+          return false;
+        continue;
+      case State::body:
+        if (!parse_cell(*c))
+          return false;
+        continue;
+      }
+    }
+    return true;
+  }
+
+  /// Completes the parsing at the end of the file
+  PatternInfo finish() {
+    if (state == State::header)
+      parse_header();
+    if (!board)
+      return info;
+    flush_run();
+    if (info.format == PatternFormat::cells) {
+      if (column > 0)
+        row++;
+      info.height = row;
+    } else if (!finished) {
+      throw std::runtime_error("RLE pattern without its final !");
+    }
+    return info;
+  }
+
+private:
+  enum class State { line_start, comment, header, body };
+
+  /// Parses a character of the cells, returning false at the end of them
+  bool parse_cell(char c) {
+    if (info.format == PatternFormat::cells) {
+      switch (c) {
+      case '.':
+        flush_run();
+        column++;
+        return true;
+      case 'O':
+      case '*':
+        run++;
+        return true;
+      case '\r':
+        return true;
+      case '\n':
+        flush_run();
+        info.width = std::max(info.width, column);
+        row++;
+        column = 0;
+        state = State::line_start;
+        return true;
+      }
+      throw invalid(c);
+    }
+
+    if (c >= '0' && c <= '9') {
+      count = count * 10 + (c - '0');
+      return true;
+    }
+    const size_t cells = count == 0 ? 1 : count;
+    count = 0;
+    switch (c) {
+    case 'b':
+    case '.':
+      column += cells;
+      return true;
+    case '$':
+      row += cells;
+      column = 0;
+      return true;
+    case '!':
+      finished = true;
+      return false;
+    case '#':
+      state = State::comment;
+      return true;
+    case ' ':
+    case '\t':
+    case '\r':
+    case '\n':
+      return true;
+    }
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+      // Every living state of a multistate pattern is a living cell.
+      add_cells(column, cells);
+      column += cells;
+      return true;
+    }
+    throw invalid(c);
+  }
+
+  std::runtime_error invalid(char c) const {
+    return std::runtime_error(std::string("invalid character '") + c +
+                              "' in row " + std::to_string(row) +
+                              " of the pattern");
+  }
+
+  /// Adds the pending run of plaintext living cells
+  void flush_run() {
+    if (run == 0)
+      return;
+    add_cells(column, run);
+    column += run;
+    run = 0;
+  }
+
+  /// Adds living cells to the current row, wrapping around the board
+  void add_cells(size_t first, size_t cells) {
+    const size_t width = board->width();
+    const size_t board_row = (top + row) % board->height();
+    size_t board_column = (left + first) % width;
+    cells = std::min(cells, width);
+    while (cells > 0) {
+      const size_t length = std::min(cells, width - board_column);
+      add_run(*board, board_row, board_column, length);
+      cells -= length;
+      board_column = 0;
+    }
+  }
+
+  /// Parses an RLE header such as x = 3, y = 3, rule = B3/S23
+  void parse_header() {
+    size_t begin = 0;
+    while (begin < line.size()) {
+      size_t end = line.find(',', begin);
+      if (end == std::string::npos)
+        end = line.size();
+      const std::string item = line.substr(begin, end - begin);
+      begin = end + 1;
+
+      const size_t equal = item.find('=');
+      if (equal == std::string::npos)
+        continue;
+      const std::string key = trim(item.substr(0, equal));
+      const std::string value = trim(item.substr(equal + 1));
+      if (key == "x")
+        info.width = std::stoull(value);
+      else if (key == "y")
+        info.height = std::stoull(value);
+      else if (key == "rule")
+        parse_rule_value(value);
+    }
+  }
+
+  /// Parses a rule in B/S notation or in the older S/B one, such as 23/3
+  void parse_rule_value(std::string value) {
+    value = value.substr(0, value.find(':'));
+    Rule rule;
+    const size_t slash = value.find('/');
+    if (!parse_rule(value, rule) &&
+        (slash == std::string::npos ||
+         !parse_rule("B" + value.substr(slash + 1) + "/S" +
+                         value.substr(0, slash),
+                     rule)))
+      throw std::runtime_error("unsupported rule " + value +
+                               " in the pattern");
+    info.has_rule = true;
+    info.rule = rule;
+  }
+
+  static std::string trim(const std::string &text) {
+    const size_t first = text.find_first_not_of(" \t\r");
+    if (first == std::string::npos)
+      return "";
+    return text.substr(first, text.find_last_not_of(" \t\r") - first + 1);
+  }
+
+  Grid *board;
+  size_t top, left;
+  PatternInfo info;
+  State state = State::line_start;
+  bool body_started = false;
+  bool finished = false;
+  std::string line; ///< Header line being read
+  size_t row = 0, column = 0;
+  size_t count = 0; ///< Run count being read in an RLE file
+  size_t run = 0;   ///< Living cells pending in a plaintext file
+};
+
+/// Format of a pattern file, from its extension
+static PatternFormat pattern_format(const std::string &path) {
+  const std::string extension = ".cells";
+  return path.size() >= extension.size() &&
+                 path.compare(path.size() - extension.size(),
+                              extension.size(), extension) == 0
+             ? PatternFormat::cells
+             : PatternFormat::rle;
+}
+
+/// Streams a pattern file through a parser
+template <typename Grid>
+static PatternInfo parse_pattern(const std::string &path, Grid *board,
+                                 size_t top, size_t left) {
+  PatternFile file(path);
+  PatternParser<Grid> parser(board, top, left, pattern_format(path));
+  const char *begin, *end;
+  try {
+    while (file.next(begin, end) && parser.feed(begin, end))
+      continue;
+    return parser.finish();
+  } catch (const std::logic_error &) {
+    throw std::runtime_error(path + ": invalid number in the pattern");
+  } catch (const std::runtime_error &error) {
+    throw std::runtime_error(path + ": " + error.what());
+  }
+}
+
+PatternInfo read_pattern_info(const std::string &path) {
+  // The board is never used when the parser has none.
+  return parse_pattern<Board>(path, nullptr, 0, 0);
+}
+
+PatternInfo load_pattern(const std::string &path, Board &board, size_t top,
+                         size_t left) {
+  return parse_pattern(path, &board, top, left);
+}
+
+PatternInfo load_pattern(const std::string &path, PackedBoard &board,
+                         size_t top, size_t left) {
+  return parse_pattern(path, &board, top, left);
+}
@@ -0,0 +1,83 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file declares the loaders of pattern files in the Run Length Encoded
+ * (.rle) and plaintext (.cells) formats.
+ *
+ * Pattern files are streamed in chunks and their runs of living cells are
+ * written straight into the board, a word at a time on a PackedBoard, so even
+ * files of hundreds of MB load in seconds without any per cell container.
+ *
+ * @see https://conwaylife.com/wiki/Run_Length_Encoded
+ * @see https://conwaylife.com/wiki/Plaintext
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#ifndef PATTERNS_H
+#define PATTERNS_H
+
+#include "game_of_life.h"
+
+/// Formats of the pattern files
+enum class PatternFormat { rle, cells };
+
+/// Description of a pattern file
+struct PatternInfo {
+  PatternFormat format = PatternFormat::rle;
+  size_t width = 0;      ///< Number of columns, from the header of an RLE file
+  size_t height = 0;     ///< Number of rows, from the header of an RLE file
+  bool has_rule = false; ///< Whether the file names the rule of the pattern
+  Rule rule = CONWAY_RULE;
+};
+
+/**
+ * Reads the description of a pattern file, stopping before its cells.
+ *
+ * Files ending in .cells are plaintext, any other file is RLE. Only RLE
+ * files have a size and a rule, read from their header line.
+ *
+ * @param path const std::string with the path of the file, or "-" for the
+ * standard input.
+ * @return PatternInfo of the file.
+ * @throws std::runtime_error if the file cannot be read or its header is
+ * invalid.
+ */
+PatternInfo read_pattern_info(const std::string &path);
+
+/**
+ * Loads a pattern file into a board, with its top left cell at (top, left).
+ *
+ * The living cells of the pattern are added to the board, which is not
+ * cleared first, so several patterns can be loaded into the same board.
+ * Cells falling past the edges wrap around the board, like its neighbours.
+ *
+ * @param path const std::string with the path of the file, or "-" for the
+ * standard input.
+ * @param board Grid passed by reference receiving the cells.
+ * @param top size_t with the row of the top left cell of the pattern.
+ * @param left size_t with the column of the top left cell of the pattern.
+ * @return PatternInfo of the file, whose size is measured for plaintext files.
+ * @throws std::runtime_error if the file cannot be read or is invalid.
+ */
+PatternInfo load_pattern(const std::string &path, Board &board, size_t top = 0,
+                         size_t left = 0);
+PatternInfo load_pattern(const std::string &path, PackedBoard &board,
+                         size_t top = 0, size_t left = 0);
+
+#endif // PATTERNS_H
@@ -0,0 +1,175 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file implements the instrumentation declared in profiler.h.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#include "profiler.h"
+
+#include <stdexcept>
+
+#ifdef GOL_PROFILE
+
+#include <fstream>
+#include <map>
+#include <set>
+
+#endif
+
+/*
+    Implementations
+*/
+
+#ifdef GOL_PROFILE
+
+Profiler &Profiler::instance() {
+  static Profiler profiler;
+  return profiler;
+}
+
+Profiler::ThreadLog &Profiler::log() {
+  thread_local ThreadLog *thread_log = nullptr;
+  if (!thread_log) {
+    std::lock_guard<std::mutex> lock(mutex);
+    logs.emplace_back(new ThreadLog{logs.size(), {}, {}});
+    thread_log = logs.back().get();
+  }
+  return *thread_log;
+}
+
+void Profiler::record(const char *name, std::uint64_t start,
+                      std::uint64_t end) {
+  log().events.push_back(
+      {name, start, end - start,
+       current_generation.load(std::memory_order_relaxed)});
+}
+
+void Profiler::count(const char *name, std::int64_t value) {
+  log().counts.push_back(
+      {name, now(), current_generation.load(std::memory_order_relaxed),
+       value});
+}
+
+/// Opens an output file of the profiler
+static std::ofstream open_profile(const std::string &path) {
+  std::ofstream file(path);
+  if (!file)
+    throw std::runtime_error(path + ": cannot write the profile");
+  return file;
+}
+
+void Profiler::write(const std::string &path) const {
+  const std::string extension = ".json";
+  if (path.size() >= extension.size() &&
+      path.compare(path.size() - extension.size(), extension.size(),
+                   extension) == 0)
+    write_trace(path);
+  else
+    write_csv(path);
+}
+
+void Profiler::write_csv(const std::string &path) const {
+  // Totals of each generation, by the name of the phase or the counter.
+  std::map<std::uint64_t, std::map<std::string, std::int64_t>> phases, counts;
+  std::set<std::string> phase_names, count_names;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto &thread_log : logs) {
+      for (const ProfileEvent &event : thread_log->events) {
+        phases[event.generation][event.name] += event.duration;
+        phase_names.insert(event.name);
+      }
+      for (const ProfileCount &count : thread_log->counts) {
+        counts[count.generation][count.name] += count.value;
+        count_names.insert(count.name);
+      }
+    }
+  }
+
+  std::set<std::uint64_t> generations;
+  for (const auto &entry : phases)
+    generations.insert(entry.first);
+  for (const auto &entry : counts)
+    generations.insert(entry.first);
+
+  std::ofstream file = open_profile(path);
+  file << "generation";
+  for (const std::string &name : phase_names)
+    file << ',' << name << "_ns";
+  for (const std::string &name : count_names)
+    file << ',' << name;
+  file << '\n';
+  for (std::uint64_t generation : generations) {
+    file << generation;
+    for (const std::string &name : phase_names)
+      file << ',' << phases[generation][name];
+    for (const std::string &name : count_names)
+      file << ',' << counts[generation][name];
+    file << '\n';
+  }
+  if (!file)
+    throw std::runtime_error(path + ": cannot write the profile");
+}
+
+void Profiler::write_trace(const std::string &path) const {
+  std::ofstream file = open_profile(path);
+  file << "{\"traceEvents\": [";
+  const char *separator = "\n";
+  std::lock_guard<std::mutex> lock(mutex);
+  for (const auto &thread_log : logs) {
+    // Timestamps of the trace format are in microseconds.
+    for (const ProfileEvent &event : thread_log->events) {
+      file << separator << "{\"name\": \"" << event.name
+           << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << thread_log->thread
+           << ", \"ts\": " << event.start / 1000.0
+           << ", \"dur\": " << event.duration / 1000.0
+           << ", \"args\": {\"generation\": " << event.generation << "}}";
+      separator = ",\n";
+    }
+    for (const ProfileCount &count : thread_log->counts) {
+      file << separator << "{\"name\": \"" << count.name
+           << "\", \"ph\": \"C\", \"pid\": 1, \"tid\": " << thread_log->thread
+           << ", \"ts\": " << count.time / 1000.0 << ", \"args\": {\""
+           << count.name << "\": " << count.value << "}}";
+      separator = ",\n";
+    }
+  }
+  file << "\n]}\n";
+  if (!file)
+    throw std::runtime_error(path + ": cannot write the profile");
+}
+
+void start_profile() { Profiler::instance().enable(); }
+
+void write_profile(const std::string &path) {
+  Profiler::instance().write(path);
+}
+
+#else
+
+void start_profile() {}
+
+void write_profile(const std::string &path) {
+  throw std::runtime_error(path +
+                           ": profiling is compiled out, build with "
+                           "make PROFILE=1");
+}
+
+#endif // GOL_PROFILE
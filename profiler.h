@@ -0,0 +1,194 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file declares the instrumentation of the hot paths of the game: scoped
+ * timers and counters recorded per thread and per generation, exported to a
+ * CSV table or to a Chrome trace (chrome://tracing, ui.perfetto.dev).
+ *
+ * The instrumentation is only compiled with GOL_PROFILE defined, by building
+ * with make PROFILE=1. Otherwise PROFILE_SCOPE, PROFILE_COUNT and
+ * PROFILE_GENERATION expand to nothing and the game runs unchanged.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <string>
+
+#ifdef GOL_PROFILE
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/// Whether the instrumentation is compiled in
+constexpr bool PROFILING_ENABLED = true;
+
+/// Phase timed by a ProfileScope
+struct ProfileEvent {
+  const char *name;         ///< Name of the phase, a string literal
+  std::uint64_t start;      ///< Start, in ns since the profiler was created
+  std::uint64_t duration;   ///< Duration in ns
+  std::uint64_t generation; ///< Generation being played
+};
+
+/// Value added to a counter by PROFILE_COUNT
+struct ProfileCount {
+  const char *name;         ///< Name of the counter, a string literal
+  std::uint64_t time;       ///< Time, in ns since the profiler was created
+  std::uint64_t generation; ///< Generation being played
+  std::int64_t value;       ///< Value added to the counter
+};
+
+/**
+ * Records the phases and counters of every thread.
+ *
+ * Each thread appends to its own log, so recording takes no lock once the
+ * log of the thread exists. Nothing is recorded until enable is called.
+ */
+class Profiler {
+public:
+  /// Profiler shared by the whole program
+  static Profiler &instance();
+
+  /// Starts recording
+  void enable() { enabled.store(true, std::memory_order_relaxed); }
+
+  /// Whether the phases are being recorded
+  bool is_enabled() const { return enabled.load(std::memory_order_relaxed); }
+
+  /// Sets the generation the next phases and counters belong to
+  void set_generation(std::uint64_t generation) {
+    current_generation.store(generation, std::memory_order_relaxed);
+  }
+
+  /// Nanoseconds since the profiler was created
+  std::uint64_t now() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - origin)
+        .count();
+  }
+
+  /// Records a phase that ran from start to end, as returned by now
+  void record(const char *name, std::uint64_t start, std::uint64_t end);
+
+  /// Adds a value to a counter
+  void count(const char *name, std::int64_t value);
+
+  /**
+   * Writes what was recorded, as a Chrome trace if path ends in .json or as
+   * a CSV table with a row per generation otherwise.
+   *
+   * The CSV table has the total ns spent by every thread in each phase and
+   * the sum of each counter.
+   *
+   * @param path const std::string with the path of the file.
+   * @throws std::runtime_error if the file cannot be written.
+   */
+  void write(const std::string &path) const;
+
+private:
+  /// Phases and counters recorded by a thread
+  struct ThreadLog {
+    size_t thread; ///< Index of the thread, in order of its first record
+    std::vector<ProfileEvent> events;
+    std::vector<ProfileCount> counts;
+  };
+
+  Profiler() : origin(std::chrono::steady_clock::now()) {}
+
+  /// Log of the calling thread, created on its first record
+  ThreadLog &log();
+
+  void write_csv(const std::string &path) const;
+  void write_trace(const std::string &path) const;
+
+  const std::chrono::steady_clock::time_point origin;
+  std::atomic<bool> enabled{false};
+  std::atomic<std::uint64_t> current_generation{0};
+  mutable std::mutex mutex; ///< Guards logs
+  std::vector<std::unique_ptr<ThreadLog>> logs;
+};
+
+/// Times the scope it lives in as a phase of the profiler
+class ProfileScope {
+public:
+  explicit ProfileScope(const char *name)
+      : name(Profiler::instance().is_enabled() ? name : nullptr),
+        start(this->name ? Profiler::instance().now() : 0) {}
+  ~ProfileScope() {
+    if (name)
+      Profiler::instance().record(name, start, Profiler::instance().now());
+  }
+
+  ProfileScope(const ProfileScope &) = delete;
+  ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+  const char *name;
+  std::uint64_t start;
+};
+
+#define PROFILE_CONCATENATE(a, b) a##b
+#define PROFILE_SCOPE_NAME(line) PROFILE_CONCATENATE(profile_scope_, line)
+
+/// Times the rest of the enclosing scope as the phase name
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_SCOPE_NAME(__LINE__)(name)
+/// Adds value to the counter name
+#define PROFILE_COUNT(name, value)                                             \
+  do {                                                                         \
+    if (Profiler::instance().is_enabled())                                     \
+      Profiler::instance().count(name, value);                                 \
+  } while (false)
+/// Sets the generation of the following phases and counters
+#define PROFILE_GENERATION(generation)                                         \
+  Profiler::instance().set_generation(generation)
+
+#else
+
+constexpr bool PROFILING_ENABLED = false;
+
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_COUNT(name, value) ((void)0)
+#define PROFILE_GENERATION(generation) ((void)0)
+
+#endif // GOL_PROFILE
+
+/**
+ * Starts recording the phases to be written by write_profile.
+ *
+ * Does nothing when the instrumentation is compiled out.
+ */
+void start_profile();
+
+/**
+ * Writes the phases and counters recorded since start_profile.
+ *
+ * @param path const std::string with the path of the file, a Chrome trace if
+ * it ends in .json or a CSV table otherwise.
+ * @throws std::runtime_error if the file cannot be written or the
+ * instrumentation is compiled out.
+ */
+void write_profile(const std::string &path);
+
+#endif // PROFILER_H
@@ -0,0 +1,232 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file implements the snapshots declared in snapshot.h.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#include "snapshot.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <utility>
+
+/*
+    Implementations
+*/
+
+/// Error of a snapshot file, with the description of errno
+static std::runtime_error snapshot_error(const std::string &path,
+                                         const std::string &what) {
+  return std::runtime_error(path + ": " + what + ": " + std::strerror(errno));
+}
+
+std::uint64_t snapshot_checksum(const PackedBoard &board) {
+  SnapshotChecksum checksum;
+  checksum.add(board.row(0), board.words_per_row() * board.height());
+  return checksum.value();
+}
+
+void SnapshotChecksum::add(const PackedBoard::Word *added, size_t count) {
+  size_t k = 0;
+  for (; k < count && (words + k) % 4 != 0; ++k)
+    lanes[(words + k) % 4] = (lanes[(words + k) % 4] ^ added[k]) * FNV_PRIME;
+  for (; k + 4 <= count; k += 4) {
+    for (size_t lane = 0; lane < 4; ++lane)
+      lanes[lane] = (lanes[lane] ^ added[k + lane]) * FNV_PRIME;
+  }
+  for (; k < count; ++k)
+    lanes[(words + k) % 4] = (lanes[(words + k) % 4] ^ added[k]) * FNV_PRIME;
+  words += count;
+}
+
+std::uint64_t SnapshotChecksum::value() const {
+  std::uint64_t checksum = FNV_OFFSET;
+  for (std::uint64_t lane : lanes)
+    checksum = (checksum ^ lane) * FNV_PRIME;
+  return checksum;
+}
+
+/// Writes a whole buffer, retrying on interruptions and partial writes
+static bool write_all(int fd, const void *buffer, size_t size) {
+  const char *bytes = static_cast<const char *>(buffer);
+  while (size > 0) {
+    const ssize_t result = ::write(fd, bytes, size);
+    if (result < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    bytes += result;
+    size -= result;
+  }
+  return true;
+}
+
+void save_snapshot(const std::string &path, const PackedBoard &board,
+                   std::uint64_t generation, const Rule &rule) {
+  SnapshotStream stream(path, board.width(), board.height());
+  stream.write(board.row(0), board.words_per_row() * board.height());
+  stream.finish(generation, rule);
+}
+
+SnapshotStream::SnapshotStream(std::string path, size_t width, size_t height)
+    : path(std::move(path)), temporary(this->path + ".tmp"), width(width),
+      height(height) {
+  fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    throw snapshot_error(temporary, "cannot create the snapshot");
+  // The header is written by finish, once the checksum is known.
+  if (lseek(fd, sizeof(SnapshotHeader), SEEK_SET) < 0) {
+    const std::runtime_error error =
+        snapshot_error(temporary, "cannot write the snapshot");
+    close(fd);
+    unlink(temporary.c_str());
+    throw error;
+  }
+}
+
+SnapshotStream::~SnapshotStream() {
+  if (fd >= 0) {
+    close(fd);
+    unlink(temporary.c_str());
+  }
+}
+
+void SnapshotStream::write(const PackedBoard::Word *added, size_t count) {
+  if (!write_all(fd, added, count * sizeof(PackedBoard::Word)))
+    throw snapshot_error(temporary, "cannot write the snapshot");
+  checksum.add(added, count);
+  words += count;
+}
+
+void SnapshotStream::finish(std::uint64_t generation, const Rule &rule) {
+  const size_t words_per_row =
+      (width + PackedBoard::WORD_BITS - 1) / PackedBoard::WORD_BITS;
+  if (words != words_per_row * height)
+    throw std::runtime_error(temporary + ": rows missing from the snapshot");
+
+  SnapshotHeader header{};
+  std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+  header.version = SNAPSHOT_VERSION;
+  header.header_size = sizeof(SnapshotHeader);
+  header.width = width;
+  header.height = height;
+  header.generation = generation;
+  header.birth = rule.birth;
+  header.survival = rule.survival;
+  header.words_per_row = words_per_row;
+  header.checksum = checksum.value();
+
+  const bool written = lseek(fd, 0, SEEK_SET) == 0 &&
+                       write_all(fd, &header, sizeof(header));
+  const int closed = close(fd);
+  fd = -1;
+  if (!written || closed < 0) {
+    const std::runtime_error error =
+        snapshot_error(temporary, "cannot write the snapshot");
+    unlink(temporary.c_str());
+    throw error;
+  }
+  if (rename(temporary.c_str(), path.c_str()) < 0)
+    throw snapshot_error(path, "cannot replace the snapshot");
+}
+
+Snapshot load_snapshot(const std::string &path, bool verify) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw snapshot_error(path, "cannot open the snapshot");
+  struct stat status;
+  if (fstat(fd, &status) < 0) {
+    const std::runtime_error error =
+        snapshot_error(path, "cannot read the snapshot");
+    close(fd);
+    throw error;
+  }
+  const size_t length = status.st_size;
+  if (length < sizeof(SnapshotHeader)) {
+    close(fd);
+    throw std::runtime_error(path + ": not a snapshot, too short");
+  }
+  // The mapping is private and writable: the board may be stepped in place
+  // without the file being modified.
+  void *mapped =
+      mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED)
+    throw snapshot_error(path, "cannot map the snapshot");
+  std::shared_ptr<void> mapping(
+      mapped, [length](void *address) { munmap(address, length); });
+
+  SnapshotHeader header;
+  std::memcpy(&header, mapped, sizeof(header));
+  if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != SNAPSHOT_VERSION ||
+      header.header_size != sizeof(SnapshotHeader))
+    throw std::runtime_error(path + ": not a snapshot of this version");
+  const std::uint64_t words_per_row =
+      (header.width + PackedBoard::WORD_BITS - 1) / PackedBoard::WORD_BITS;
+  if (header.width == 0 || header.height == 0 || header.birth & 1 ||
+      header.birth >> 9 || header.survival >> 9 ||
+      header.words_per_row != words_per_row ||
+      (length - header.header_size) / sizeof(PackedBoard::Word) /
+              words_per_row <
+          header.height)
+    throw std::runtime_error(path + ": truncated or corrupted snapshot");
+
+  Snapshot snapshot;
+  snapshot.board = PackedBoard(
+      header.width, header.height,
+      std::shared_ptr<PackedBoard::Word>(
+          mapping, reinterpret_cast<PackedBoard::Word *>(
+                       static_cast<char *>(mapped) + header.header_size)));
+  snapshot.generation = header.generation;
+  snapshot.rule = Rule{header.birth, header.survival};
+  if (verify && snapshot_checksum(snapshot.board) != header.checksum)
+    throw std::runtime_error(path + ": checksum mismatch");
+  return snapshot;
+}
+
+SnapshotWriter::~SnapshotWriter() {
+  if (writer.joinable())
+    writer.join();
+}
+
+void SnapshotWriter::write(PackedBoard board, std::uint64_t generation,
+                           const Rule &rule) {
+  wait();
+  writer = std::thread([this, board = std::move(board), generation, rule] {
+    try {
+      save_snapshot(path, board, generation, rule);
+    } catch (...) {
+      error = std::current_exception();
+    }
+  });
+}
+
+void SnapshotWriter::wait() {
+  if (writer.joinable())
+    writer.join();
+  if (error)
+    std::rethrow_exception(std::exchange(error, nullptr));
+}
@@ -0,0 +1,216 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file declares the binary snapshots used to checkpoint and restore a
+ * game of life.
+ *
+ * A snapshot is a 64 byte SnapshotHeader followed by the rows of a
+ * PackedBoard, words_per_row 64 bit words each, in the byte order of the
+ * machine that wrote it. Restoring maps the file in memory and uses the rows
+ * in place, so even a board of several GB is restored at once and only read
+ * from disk as it is stepped.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "game_of_life.h"
+
+#include <exception>
+
+/// First bytes of every snapshot file
+const char SNAPSHOT_MAGIC[8] = {'G', 'O', 'L', 'S', 'N', 'A', 'P', '\0'};
+const std::uint32_t SNAPSHOT_VERSION = 1; ///< Version of the snapshot format
+
+/// Header at the start of a snapshot file
+struct SnapshotHeader {
+  char magic[8];              ///< SNAPSHOT_MAGIC
+  std::uint32_t version;      ///< SNAPSHOT_VERSION
+  std::uint32_t header_size;  ///< Offset of the rows, sizeof(SnapshotHeader)
+  std::uint64_t width;        ///< Number of columns of the board
+  std::uint64_t height;       ///< Number of rows of the board
+  std::uint64_t generation;   ///< Generation of the board
+  std::uint16_t birth;        ///< Rule::birth of the game
+  std::uint16_t survival;     ///< Rule::survival of the game
+  std::uint32_t words_per_row; ///< Number of words of each row
+  std::uint64_t checksum;     ///< snapshot_checksum of the rows
+  std::uint8_t reserved[8];   ///< Kept at zero
+};
+static_assert(sizeof(SnapshotHeader) == 64, "the header has a fixed size");
+
+/// Board of a snapshot with the generation and the rule it was saved at
+struct Snapshot {
+  PackedBoard board;
+  std::uint64_t generation = 0;
+  Rule rule = CONWAY_RULE;
+};
+
+/**
+ * Computes the checksum stored in the header of a snapshot.
+ *
+ * The words of the rows go through FNV-1a in four interleaved lanes, a word
+ * at a time, so that checking a large board is bound by the memory bandwidth.
+ *
+ * @param board PackedBoard passed as const reference.
+ * @return uint64_t with the checksum of the rows of board.
+ */
+std::uint64_t snapshot_checksum(const PackedBoard &board);
+
+/// snapshot_checksum computed as the words of the rows come, in order
+class SnapshotChecksum {
+public:
+  /// Adds the next count words of the rows
+  void add(const PackedBoard::Word *words, size_t count);
+
+  /// Checksum of the words added so far
+  std::uint64_t value() const;
+
+private:
+  static const std::uint64_t FNV_OFFSET = 0xCBF29CE484222325ull;
+  static const std::uint64_t FNV_PRIME = 0x100000001B3ull;
+
+  std::uint64_t lanes[4] = {FNV_OFFSET, FNV_OFFSET, FNV_OFFSET, FNV_OFFSET};
+  size_t words = 0; ///< Number of words added, selecting the next lane
+};
+
+/**
+ * Writes a snapshot a few rows at a time, for boards that are never whole in
+ * the memory of a single process.
+ *
+ * Like save_snapshot, the rows go to a file next to path, renamed over path
+ * by finish. The file is removed if finish is never called.
+ */
+class SnapshotStream {
+public:
+  /**
+   * @param path std::string with the path of the snapshot file.
+   * @param width size_t with the number of columns of the board.
+   * @param height size_t with the number of rows of the board.
+   * @throws std::runtime_error if the file cannot be created.
+   */
+  SnapshotStream(std::string path, size_t width, size_t height);
+  ~SnapshotStream();
+
+  SnapshotStream(const SnapshotStream &) = delete;
+  SnapshotStream &operator=(const SnapshotStream &) = delete;
+
+  /**
+   * Writes the next rows of the board, words_per_row words each.
+   *
+   * @throws std::runtime_error if the file cannot be written.
+   */
+  void write(const PackedBoard::Word *words, size_t count);
+
+  /**
+   * Writes the header once every row is written and replaces path.
+   *
+   * @param generation uint64_t with the generation of the board.
+   * @param rule const Rule of the game.
+   * @throws std::runtime_error if rows are missing or the file cannot be
+   * written.
+   */
+  void finish(std::uint64_t generation, const Rule &rule);
+
+private:
+  std::string path;
+  std::string temporary; ///< File written until finish renames it
+  int fd = -1;
+  size_t width, height;
+  size_t words = 0; ///< Number of words written
+  SnapshotChecksum checksum;
+};
+
+/**
+ * Writes a snapshot of a board.
+ *
+ * The snapshot is first written next to path and then renamed, so path always
+ * holds a complete snapshot even if the program stops while writing.
+ *
+ * @param path const std::string with the path of the snapshot file.
+ * @param board PackedBoard passed as const reference to be saved.
+ * @param generation uint64_t with the generation of board.
+ * @param rule const Rule of the game.
+ * @throws std::runtime_error if the file cannot be written.
+ */
+void save_snapshot(const std::string &path, const PackedBoard &board,
+                   std::uint64_t generation, const Rule &rule);
+
+/**
+ * Restores a snapshot by mapping its file in memory.
+ *
+ * The board of the snapshot uses the mapped rows in place: they are read from
+ * disk when first touched and privately copied when written, leaving the file
+ * untouched.
+ *
+ * @param path const std::string with the path of the snapshot file.
+ * @param verify bool, true to compare the rows with the checksum, which reads
+ * the whole file.
+ * @return Snapshot with the restored board, generation and rule.
+ * @throws std::runtime_error if the file cannot be read, is not a snapshot or
+ * fails the checksum.
+ */
+Snapshot load_snapshot(const std::string &path, bool verify = true);
+
+/**
+ * Writes snapshots of a running game from a background thread.
+ *
+ * Each board is copied before write returns, so the game keeps stepping
+ * while the previous generation is written.
+ */
+class SnapshotWriter {
+public:
+  /**
+   * @param path std::string with the path of the snapshot file, overwritten
+   * by every snapshot.
+   */
+  explicit SnapshotWriter(std::string path) : path(std::move(path)) {}
+  ~SnapshotWriter();
+
+  SnapshotWriter(const SnapshotWriter &) = delete;
+  SnapshotWriter &operator=(const SnapshotWriter &) = delete;
+
+  /**
+   * Starts writing a snapshot, after waiting for the previous one.
+   *
+   * @param board PackedBoard passed by value, the copy being saved.
+   * @param generation uint64_t with the generation of board.
+   * @param rule const Rule of the game.
+   */
+  void write(PackedBoard board, std::uint64_t generation, const Rule &rule);
+
+  /// Packs a Board before writing it
+  void write(const Board &board, std::uint64_t generation, const Rule &rule) {
+    write(pack_board(board), generation, rule);
+  }
+
+  /**
+   * Waits for the snapshot being written.
+   *
+   * @throws std::runtime_error if it could not be written.
+   */
+  void wait();
+
+private:
+  std::string path;
+  std::thread writer;
+  std::exception_ptr error;
+};
+
+#endif // SNAPSHOT_H
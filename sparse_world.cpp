@@ -0,0 +1,158 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file implements the sparse engine declared in sparse_world.h.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#include "sparse_world.h"
+
+/*
+    Implementations
+*/
+
+SparseWorld::ChunkPosition SparseWorld::chunk_of(std::int64_t row,
+                                                 std::int64_t column) {
+  const std::int64_t size = CHUNK_SIZE;
+  // Rounds towards minus infinity, so that negative cells get their own chunks.
+  return {row >= 0 ? row / size : -((-row - 1) / size) - 1,
+          column >= 0 ? column / size : -((-column - 1) / size) - 1};
+}
+
+void SparseWorld::clear() {
+  chunks.clear();
+  living_cells = 0;
+  generations = 0;
+}
+
+void SparseWorld::set(std::int64_t row, std::int64_t column, Cell cell) {
+  const ChunkPosition position = chunk_of(row, column);
+  const std::int64_t size = CHUNK_SIZE;
+  const Word bit = Word(1) << (column - position.column * size);
+  auto found = chunks.find(position);
+  if (found == chunks.end()) {
+    if (cell == Cell::dead)
+      return;
+    found = chunks.emplace(position, Chunk()).first;
+  }
+
+  Word &word = found->second[row - position.row * size];
+  living_cells -= (word & bit) != 0;
+  if (cell == Cell::alive)
+    word |= bit;
+  else
+    word &= ~bit;
+  living_cells += (word & bit) != 0;
+
+  if (count_living_cells(found->second.data(),
+                         found->second.data() + CHUNK_SIZE) == 0)
+    chunks.erase(found);
+}
+
+Cell SparseWorld::get(std::int64_t row, std::int64_t column) const {
+  const ChunkPosition position = chunk_of(row, column);
+  const std::int64_t size = CHUNK_SIZE;
+  const Word word = chunk_at(position)[row - position.row * size];
+  return (word >> (column - position.column * size)) & 1 ? Cell::alive
+                                                         : Cell::dead;
+}
+
+const SparseWorld::Chunk &
+SparseWorld::chunk_at(const ChunkPosition &position) const {
+  static const Chunk dead_chunk{};
+  const auto found = chunks.find(position);
+  return found == chunks.end() ? dead_chunk : found->second;
+}
+
+void SparseWorld::update_chunk(const ChunkPosition &position,
+                               Chunk &next) const {
+  const Chunk *around[3][3];
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j)
+      around[i][j] = &chunk_at({position.row + i - 1, position.column + j - 1});
+  }
+
+  // Rows -1 to CHUNK_SIZE of the chunk, each made of the words of the west
+  // chunk, the chunk itself and the east chunk, so that the packed kernel can
+  // update the middle word as the interior of a three word row.
+  Word lines[CHUNK_SIZE + 2][3];
+  for (size_t i = 0; i < CHUNK_SIZE + 2; ++i) {
+    const size_t band = i == 0 ? 0 : i == CHUNK_SIZE + 1 ? 2 : 1;
+    const size_t row = (i + CHUNK_SIZE - 1) % CHUNK_SIZE;
+    for (size_t j = 0; j < 3; ++j)
+      lines[i][j] = (*around[band][j])[row];
+  }
+
+  const PackedRowKernel kernel = packed_kernel().kernel;
+  for (size_t i = 0; i < CHUNK_SIZE; ++i) {
+    Word next_line[3];
+    kernel(lines[i], lines[i + 1], lines[i + 2], next_line, 1, 2);
+    next[i] = next_line[1];
+  }
+}
+
+void SparseWorld::step(std::uint64_t generations) {
+  for (; generations > 0; --generations) {
+    PROFILE_SCOPE("sparse_step");
+    PROFILE_COUNT("chunks", chunks.size());
+    // A chunk can only come to life next to the border cells of a living one.
+    candidates.clear();
+    for (const auto &entry : chunks) {
+      const ChunkPosition &position = entry.first;
+      const Chunk &chunk = entry.second;
+      const Word top = chunk[0], bottom = chunk[CHUNK_SIZE - 1];
+      Word any = 0;
+      for (Word word : chunk)
+        any |= word;
+
+      candidates.insert(position);
+      if (top)
+        candidates.insert({position.row - 1, position.column});
+      if (bottom)
+        candidates.insert({position.row + 1, position.column});
+      if (any & 1)
+        candidates.insert({position.row, position.column - 1});
+      if (any >> 63)
+        candidates.insert({position.row, position.column + 1});
+      if (top & 1)
+        candidates.insert({position.row - 1, position.column - 1});
+      if (top >> 63)
+        candidates.insert({position.row - 1, position.column + 1});
+      if (bottom & 1)
+        candidates.insert({position.row + 1, position.column - 1});
+      if (bottom >> 63)
+        candidates.insert({position.row + 1, position.column + 1});
+    }
+
+    next_chunks.clear();
+    living_cells = 0;
+    for (const ChunkPosition &position : candidates) {
+      Chunk next;
+      update_chunk(position, next);
+      const size_t population =
+          count_living_cells(next.data(), next.data() + CHUNK_SIZE);
+      if (population) {
+        next_chunks.emplace(position, next);
+        living_cells += population;
+      }
+    }
+    chunks.swap(next_chunks);
+    this->generations++;
+  }
+}
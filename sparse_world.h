@@ -0,0 +1,189 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file declares a sparse engine for Conway's Game of Life, meant for huge
+ * and mostly empty universes.
+ *
+ * Only the chunks of 64x64 cells holding living cells are stored, one bit per
+ * cell, in a hash map keyed by their position. Chunks are allocated when a
+ * pattern grows into them and dropped when they die out, so memory and step
+ * cost follow the population rather than the area of its bounding box.
+ *
+ * Like HashLife, and unlike the boards of game_of_life.h, the universe is an
+ * unbounded plane, not a torus.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#ifndef SPARSE_WORLD_H
+#define SPARSE_WORLD_H
+
+#include "game_of_life.h"
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+/**
+ * Universe on an unbounded plane storing only its living chunks.
+ *
+ * Cells are addressed by signed (row, column) coordinates. Loading a board
+ * places its cell (i, j) at (i, j), so the board area can be read back after
+ * advancing the universe.
+ */
+class SparseWorld {
+public:
+  typedef PackedBoard::Word Word;
+  /// Number of rows and columns of a chunk, one Word per row
+  static const size_t CHUNK_SIZE = PackedBoard::WORD_BITS;
+
+  /**
+   * Replaces the universe by the cells of a board, at generation 0.
+   *
+   * @tparam Grid Board or PackedBoard to be loaded.
+   * @param board Grid passed as const reference to be loaded.
+   */
+  template <typename Grid> void load(const Grid &board) {
+    clear();
+    for (size_t i = 0; i < board.height(); ++i) {
+      for (size_t j = 0; j < board.width(); ++j) {
+        if (board.get(i, j) == Cell::alive)
+          set(i, j, Cell::alive);
+      }
+    }
+  }
+
+  /// Kills every cell and resets the generation to 0
+  void clear();
+
+  /**
+   * Sets the state of a cell.
+   *
+   * @param row int64_t with the row of the cell.
+   * @param column int64_t with the column of the cell.
+   * @param cell Cell with the new state.
+   */
+  void set(std::int64_t row, std::int64_t column, Cell cell);
+
+  /**
+   * Gets the state of a cell.
+   *
+   * @param row int64_t with the row of the cell.
+   * @param column int64_t with the column of the cell.
+   * @return Cell with the state of the cell.
+   */
+  Cell get(std::int64_t row, std::int64_t column) const;
+
+  /**
+   * Copies a region of the universe into a board.
+   *
+   * Only the living chunks are visited, so reading a sparse region costs
+   * little more than clearing the board.
+   *
+   * @tparam Grid Board or PackedBoard receiving the cells.
+   * @param board Grid passed by reference, whose size is the size of the
+   * region.
+   * @param top int64_t with the row of the universe copied to row 0.
+   * @param left int64_t with the column of the universe copied to column 0.
+   */
+  template <typename Grid>
+  void read(Grid &board, std::int64_t top = 0, std::int64_t left = 0) const;
+
+  /**
+   * Advances the universe by a number of generations.
+   *
+   * Only the living chunks and the neighbours their border cells reach are
+   * updated.
+   *
+   * @param generations uint64_t with the number of generations.
+   */
+  void step(std::uint64_t generations = 1);
+
+  /// Number of generations since the universe was loaded or cleared
+  std::uint64_t generation() const { return generations; }
+
+  /// Number of living cells
+  std::uint64_t population() const { return living_cells; }
+
+  /// Number of chunks currently allocated
+  size_t chunk_count() const { return chunks.size(); }
+
+private:
+  /// Square of CHUNK_SIZE x CHUNK_SIZE cells, bit b of rows[i] is column b
+  typedef std::array<Word, CHUNK_SIZE> Chunk;
+
+  /// Position of a chunk, in units of CHUNK_SIZE cells
+  struct ChunkPosition {
+    std::int64_t row, column;
+    bool operator==(const ChunkPosition &other) const {
+      return row == other.row && column == other.column;
+    }
+  };
+
+  struct ChunkHash {
+    size_t operator()(const ChunkPosition &position) const {
+      return std::hash<std::uint64_t>()(
+          std::uint64_t(position.row) * 0x9E3779B97F4A7C15ull ^
+          std::uint64_t(position.column));
+    }
+  };
+
+  typedef std::unordered_map<ChunkPosition, Chunk, ChunkHash> ChunkMap;
+
+  /// Chunk at a position, or a dead one when it is not allocated
+  const Chunk &chunk_at(const ChunkPosition &position) const;
+
+  /// Next generation of the chunk at a position
+  void update_chunk(const ChunkPosition &position, Chunk &next) const;
+
+  static ChunkPosition chunk_of(std::int64_t row, std::int64_t column);
+
+  ChunkMap chunks;
+  ChunkMap next_chunks; ///< Kept between steps to reuse its buckets
+  std::unordered_set<ChunkPosition, ChunkHash> candidates;
+  std::uint64_t living_cells = 0;
+  std::uint64_t generations = 0;
+};
+
+template <typename Grid>
+void SparseWorld::read(Grid &board, std::int64_t top,
+                       std::int64_t left) const {
+  const std::int64_t size = CHUNK_SIZE;
+  clear_region(board, 0, board.height(), 0, board.width());
+  for (const auto &entry : chunks) {
+    const std::int64_t chunk_top = entry.first.row * size - top;
+    const std::int64_t chunk_left = entry.first.column * size - left;
+    if (chunk_top >= std::int64_t(board.height()) ||
+        chunk_left >= std::int64_t(board.width()) || chunk_top + size <= 0 ||
+        chunk_left + size <= 0)
+      continue;
+    for (std::int64_t i = 0; i < size; ++i) {
+      const std::int64_t row = chunk_top + i;
+      if (row < 0 || row >= std::int64_t(board.height()))
+        continue;
+      for (Word word = entry.second[i]; word; word &= word - 1) {
+        const std::int64_t column = chunk_left + __builtin_ctzll(word);
+        if (column >= 0 && column < std::int64_t(board.width()))
+          board.set(row, column, Cell::alive);
+      }
+    }
+  }
+}
+
+#endif // SPARSE_WORLD_H
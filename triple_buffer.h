@@ -0,0 +1,92 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file declares the triple buffer handing the generations computed by
+ * the simulation thread to the render thread, without locks: each side owns
+ * one of the three slots and they swap the third one with a single atomic
+ * exchange, so neither ever waits for the other.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+/**
+ * Single producer, single consumer exchange of the latest value.
+ *
+ * The writer fills back() and publishes it; the reader takes the last value
+ * published with update() and reads it at front(). Values published while
+ * the reader is busy replace each other, the reader only ever sees the most
+ * recent one.
+ *
+ * @tparam T type of the values, copied three times on construction.
+ */
+template <typename T> class TripleBuffer {
+public:
+  explicit TripleBuffer(const T &initial) : slots{initial, initial, initial} {}
+
+  TripleBuffer(const TripleBuffer &) = delete;
+  TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+  /// Slot filled by the writer, only accessed from the writer thread
+  T &back() { return slots[back_index]; }
+
+  /// Hands back() to the reader, and another slot to the writer
+  void publish() {
+    back_index = middle.exchange(back_index | FRESH, std::memory_order_acq_rel) &
+                 INDEX;
+  }
+
+  /**
+   * Whether the reader took the last value published, for a writer only
+   * filling back() when it is going to be read.
+   */
+  bool consumed() const {
+    return !(middle.load(std::memory_order_relaxed) & FRESH);
+  }
+
+  /**
+   * Moves the last value published to front(), only from the reader thread.
+   *
+   * @return bool true if a value was published since the last update.
+   */
+  bool update() {
+    if (consumed())
+      return false;
+    front_index =
+        middle.exchange(front_index, std::memory_order_acq_rel) & INDEX;
+    return true;
+  }
+
+  /// Value read by the reader, only accessed from the reader thread
+  const T &front() const { return slots[front_index]; }
+
+private:
+  static const unsigned INDEX = 3; ///< Bits of the index of a slot
+  static const unsigned FRESH = 4; ///< Set when the middle slot is unread
+
+  T slots[3];
+  unsigned back_index = 0;
+  std::atomic<unsigned> middle{1};
+  unsigned front_index = 2;
+};
+
+#endif // TRIPLE_BUFFER_H
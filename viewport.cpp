@@ -0,0 +1,369 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file implements the viewports declared in viewport.h: the density
+ * maps, the glyphs of the renderer and the keys panning and zooming.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#include "viewport.h"
+
+#include <cerrno>
+#include <cmath>
+#include <csignal>
+#include <limits>
+#include <sys/ioctl.h>
+#include <termios.h>
+
+/*
+    Implementations
+*/
+
+typedef PackedBoard::Word Word;
+
+bool parse_view_mode(const std::string &name, ViewMode &mode) {
+  if (name == "cells")
+    mode = ViewMode::cells;
+  else if (name == "braille")
+    mode = ViewMode::braille;
+  else if (name == "half")
+    mode = ViewMode::half_blocks;
+  else
+    return false;
+  return true;
+}
+
+unsigned fit_zoom(size_t width, size_t height, size_t dot_columns,
+                  size_t dot_rows) {
+  unsigned zoom = 0;
+  while (zoom < MAX_ZOOM &&
+         ((dot_columns << zoom) < width || (dot_rows << zoom) < height))
+    zoom++;
+  return zoom;
+}
+
+/// Moves a coordinate of a viewport by a signed step, staying on the board
+static size_t pan(size_t corner, size_t step, bool forward, size_t cells) {
+  if (!forward)
+    return corner - std::min(corner, step);
+  return std::min(corner + step, cells ? cells - 1 : 0);
+}
+
+/// Corner of a view of some cells keeping its centre at the same cell
+static size_t recentre(size_t corner, size_t cells, size_t new_cells,
+                       size_t limit) {
+  const size_t centre = corner + cells / 2;
+  return std::min(centre - std::min(centre, new_cells / 2),
+                  limit ? limit - 1 : 0);
+}
+
+bool steer_viewport(Viewport &view, int key, size_t width, size_t height,
+                    size_t dot_columns, size_t dot_rows) {
+  const Viewport before = view;
+  const size_t side = size_t(1) << view.zoom;
+  const size_t row_step = std::max(side, dot_rows * side / 4);
+  const size_t column_step = std::max(side, dot_columns * side / 4);
+  switch (key) {
+  case KEY_UP:
+  case 'k':
+    view.top = pan(view.top, row_step, false, height);
+    break;
+  case KEY_DOWN:
+  case 'j':
+    view.top = pan(view.top, row_step, true, height);
+    break;
+  case KEY_LEFT:
+  case 'h':
+    view.left = pan(view.left, column_step, false, width);
+    break;
+  case KEY_RIGHT:
+  case 'l':
+    view.left = pan(view.left, column_step, true, width);
+    break;
+  case '+':
+  case '=':
+  case '-':
+  case '_': {
+    const bool in = key == '+' || key == '=';
+    if (in ? view.zoom == 0 : view.zoom == MAX_ZOOM)
+      return false;
+    view.zoom += in ? -1 : 1;
+    const size_t new_side = size_t(1) << view.zoom;
+    view.top = recentre(view.top, dot_rows * side, dot_rows * new_side, height);
+    view.left =
+        recentre(view.left, dot_columns * side, dot_columns * new_side, width);
+    break;
+  }
+  default:
+    return false;
+  }
+  return view.top != before.top || view.left != before.left ||
+         view.zoom != before.zoom;
+}
+
+/// Living cells of every byte of a word, in the bytes of the result
+static Word byte_popcounts(Word x) {
+  x -= (x >> 1) & 0x5555555555555555ull;
+  x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+  return (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+}
+
+void DensityMap::build(const Board &board) {
+  PROFILE_SCOPE("density");
+  tile_columns = (board.width() + 7) >> TILE_ZOOM;
+  tile_rows = (board.height() + 7) >> TILE_ZOOM;
+  tiles.assign(tile_columns * tile_rows, 0);
+  for (size_t i = 0; i < board.height(); ++i) {
+    const Cell *row = board.row(i);
+    std::uint8_t *counts = tiles.data() + (i >> TILE_ZOOM) * tile_columns;
+    for (size_t j = 0; j < board.width(); ++j)
+      counts[j >> TILE_ZOOM] += static_cast<std::uint8_t>(row[j]);
+  }
+  summarise();
+}
+
+void DensityMap::build(const PackedBoard &board) {
+  PROFILE_SCOPE("density");
+  tile_columns = (board.width() + 7) >> TILE_ZOOM;
+  tile_rows = (board.height() + 7) >> TILE_ZOOM;
+  tiles.assign(tile_columns * tile_rows, 0);
+  // A byte of a word is a row of a tile; the counts of the eight rows of a
+  // tile add up in the bytes of a word without overflowing.
+  std::vector<Word> sums(board.words_per_row());
+  for (size_t t = 0; t < tile_rows; ++t) {
+    std::fill(sums.begin(), sums.end(), 0);
+    for (size_t i = t << TILE_ZOOM;
+         i < std::min((t + 1) << TILE_ZOOM, board.height()); ++i) {
+      const Word *row = board.row(i);
+      for (size_t k = 0; k < sums.size(); ++k)
+        sums[k] += byte_popcounts(row[k]);
+    }
+    std::uint8_t *counts = tiles.data() + t * tile_columns;
+    for (size_t k = 0; k < sums.size(); ++k)
+      for (size_t b = 0; b < 8 && k * 8 + b < tile_columns; ++b)
+        counts[k * 8 + b] = static_cast<std::uint8_t>(sums[k] >> (8 * b));
+  }
+  summarise();
+}
+
+void DensityMap::summarise() {
+  levels.clear();
+  size_t columns = tile_columns, rows = tile_rows;
+  while (columns > 1 || rows > 1) {
+    Level level;
+    level.columns = (columns + 1) / 2;
+    level.rows = (rows + 1) / 2;
+    level.counts.assign(level.columns * level.rows, 0);
+    for (size_t i = 0; i < rows; ++i) {
+      for (size_t j = 0; j < columns; ++j) {
+        // Only boards of billions of cells could overflow the top levels.
+        std::uint32_t &count = level.counts[i / 2 * level.columns + j / 2];
+        const std::uint64_t sum =
+            std::uint64_t(count) +
+            (levels.empty() ? tiles[i * columns + j]
+                            : levels.back().counts[i * columns + j]);
+        count = static_cast<std::uint32_t>(std::min<std::uint64_t>(
+            sum, std::numeric_limits<std::uint32_t>::max()));
+      }
+    }
+    columns = level.columns;
+    rows = level.rows;
+    levels.push_back(std::move(level));
+  }
+}
+
+std::uint32_t DensityMap::count(unsigned zoom, size_t row,
+                                size_t column) const {
+  const unsigned level = zoom - TILE_ZOOM;
+  if (level == 0)
+    return row < tile_rows && column < tile_columns
+               ? tiles[row * tile_columns + column]
+               : 0;
+  // Squares larger than the top level hold the whole board or nothing.
+  if (level > levels.size()) {
+    if (row || column)
+      return 0;
+    return levels.empty() ? (tiles.empty() ? 0 : tiles[0])
+                          : levels.back().counts[0];
+  }
+  const Level &squares = levels[level - 1];
+  return row < squares.rows && column < squares.columns
+             ? squares.counts[row * squares.columns + column]
+             : 0;
+}
+
+ViewportRenderer::ViewportRenderer(ViewMode mode, int fd)
+    : mode(mode), fd(fd), dot_width(mode == ViewMode::braille ? 2 : 1),
+      dot_height(mode == ViewMode::braille ? 4 : 2) {}
+
+void ViewportRenderer::dots(size_t &dot_columns, size_t &dot_rows) const {
+  terminal_size(dot_columns, dot_rows);
+  dot_columns *= dot_width;
+  dot_rows *= dot_height;
+}
+
+size_t ViewportRenderer::glyphs(size_t cells, size_t corner, size_t side,
+                                size_t dots_per_glyph) {
+  if (corner >= cells)
+    return 0;
+  const size_t dots = (cells - corner + side - 1) / side;
+  return (dots + dots_per_glyph - 1) / dots_per_glyph;
+}
+
+void ViewportRenderer::terminal_size(size_t &columns, size_t &rows) const {
+  winsize size;
+  if (ioctl(fd, TIOCGWINSZ, &size) == 0 && size.ws_col && size.ws_row) {
+    columns = size.ws_col;
+    rows = size.ws_row;
+  } else {
+    columns = 80;
+    rows = 24;
+  }
+  rows = std::max<size_t>(rows, 2) - 1;
+}
+
+/// Bits of the dots of a braille glyph, by row and column of the dot
+static const unsigned BRAILLE_DOTS[4][2] = {
+    {0x01, 0x08}, {0x02, 0x10}, {0x04, 0x20}, {0x40, 0x80}};
+
+/**
+ * Grey of the 256 colour palette shading a square of 2^zoom cells per side:
+ * black when it is empty, then from dark grey to white with the square root
+ * of its density, so sparse squares stay visible.
+ */
+static unsigned shade(std::uint32_t living, unsigned zoom) {
+  if (living == 0)
+    return 16;
+  const double density =
+      std::min(1.0, living / std::ldexp(1.0, 2 * static_cast<int>(zoom)));
+  return 233 + static_cast<unsigned>(std::sqrt(density) * 22 + 0.5);
+}
+
+void ViewportRenderer::append_glyph(const std::uint32_t living[2][4],
+                                    unsigned zoom) {
+  if (mode == ViewMode::braille) {
+    unsigned bits = 0;
+    for (size_t y = 0; y < 4; ++y)
+      for (size_t x = 0; x < 2; ++x)
+        if (living[x][y])
+          bits |= BRAILLE_DOTS[y][x];
+    if (bits == 0) {
+      line += ' ';
+      return;
+    }
+    // U+2800 to U+28FF in UTF-8
+    line += '\xe2';
+    line += static_cast<char>(0xa0 | bits >> 6);
+    line += static_cast<char>(0x80 | (bits & 0x3f));
+    return;
+  }
+
+  const unsigned upper = shade(living[0][0], zoom);
+  const unsigned lower = shade(living[0][1], zoom);
+  if (upper != colours[0])
+    line += "\x1b[38;5;" + std::to_string(upper) + 'm';
+  if (lower != colours[1])
+    line += "\x1b[48;5;" + std::to_string(lower) + 'm';
+  colours[0] = upper;
+  colours[1] = lower;
+  line += "\xe2\x96\x80"; // U+2580, the upper half block
+}
+
+void ViewportRenderer::end_line() {
+  if (mode == ViewMode::half_blocks)
+    line += "\x1b[0m";
+  colours[0] = colours[1] = 0;
+}
+
+void ViewportRenderer::move_cursor(size_t line, size_t column) {
+  frame += "\x1b[" + std::to_string(line + 1) + ';' +
+           std::to_string(column + 1) + 'H';
+}
+
+void ViewportRenderer::flush() {
+  size_t written = 0;
+  while (written < frame.size()) {
+    const ssize_t result =
+        write(fd, frame.data() + written, frame.size() - written);
+    if (result < 0) {
+      if (errno == EINTR)
+        continue;
+      return;
+    }
+    written += result;
+  }
+}
+
+/// Settings of the terminal before TerminalInput, restored on SIGINT
+static termios line_mode;
+static struct sigaction default_interrupt;
+
+static void restore_on_interrupt(int signal) {
+  tcsetattr(STDIN_FILENO, TCSANOW, &line_mode);
+  sigaction(SIGINT, &default_interrupt, nullptr);
+  raise(signal);
+}
+
+TerminalInput::TerminalInput() {
+  if (!isatty(STDIN_FILENO) || tcgetattr(STDIN_FILENO, &line_mode) != 0)
+    return;
+  termios keys = line_mode;
+  keys.c_lflag &= ~(ICANON | ECHO);
+  keys.c_cc[VMIN] = 0;
+  keys.c_cc[VTIME] = 0;
+  struct sigaction interrupt = {};
+  interrupt.sa_handler = restore_on_interrupt;
+  sigemptyset(&interrupt.sa_mask);
+  sigaction(SIGINT, &interrupt, &default_interrupt);
+  raw = tcsetattr(STDIN_FILENO, TCSANOW, &keys) == 0;
+}
+
+TerminalInput::~TerminalInput() {
+  if (!raw)
+    return;
+  tcsetattr(STDIN_FILENO, TCSANOW, &line_mode);
+  sigaction(SIGINT, &default_interrupt, nullptr);
+}
+
+int TerminalInput::read_key() {
+  if (!raw)
+    return NO_KEY;
+  char buffer[64];
+  const ssize_t count = read(STDIN_FILENO, buffer, sizeof(buffer));
+  if (count > 0)
+    pending.append(buffer, count);
+  if (pending.empty())
+    return NO_KEY;
+
+  if (pending[0] != '\x1b') {
+    const int key = static_cast<unsigned char>(pending[0]);
+    pending.erase(0, 1);
+    return key;
+  }
+  // The arrows send ESC [ A to D; other escapes are dropped.
+  int key = NO_KEY;
+  if (pending.size() >= 3 && pending[1] == '[') {
+    const char arrows[] = "ABDC";
+    for (int a = 0; a < 4; ++a)
+      if (pending[2] == arrows[a])
+        key = KEY_UP + a;
+  }
+  pending.erase(0, std::min<size_t>(pending.size(), 3));
+  return key;
+}
@@ -0,0 +1,291 @@
+/*
+ * This file is part of a C++ Generative Art Project.
+ *
+ *
+ * Developed by Patric Lacouth;
+ *
+ * This file declares the viewports, drawing a window of a board too large
+ * for the terminal. A viewport can be panned and zoomed out, showing a square
+ * of 2^zoom cells per side as each dot of a braille glyph, 2x4 dots per
+ * character, or as each half of a half block shaded by the density of the
+ * square.
+ *
+ * The living cells of the squares are read from a DensityMap, a pyramid of
+ * the populations of the 8x8 tiles of the board, of their 16x16 parents and
+ * so on. Drawing a dot then costs a lookup at any zoom, so a frame costs as
+ * much for a board of a billion cells as for a board filling the terminal.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. To know more about GNU GPL,
+ * see <https://www.gnu.org/licenses/>.
+ *
+ * You can see further developments accessing:
+ * @see github.com/lacouth/cpp_game_of_life
+ */
+
+#ifndef VIEWPORT_H
+#define VIEWPORT_H
+
+#include "game_of_life.h"
+
+#include <string>
+#include <vector>
+
+/// How the board is drawn on the terminal
+enum class ViewMode {
+  cells,      ///< The whole board, a cell per character, by TerminalRenderer
+  braille,    ///< A viewport of braille glyphs, 2x4 dots each
+  half_blocks ///< A viewport of half blocks, 1x2 shaded dots each
+};
+
+/**
+ * Parses the name of a view mode: cells, braille or half.
+ *
+ * @param name const std::string with the name.
+ * @param mode ViewMode passed by reference, set when the name is valid.
+ * @return bool true if the name is the one of a mode.
+ */
+bool parse_view_mode(const std::string &name, ViewMode &mode);
+
+/// Window of a board shown by a ViewportRenderer
+struct Viewport {
+  size_t top = 0;    ///< Row of the cell at the top left corner
+  size_t left = 0;   ///< Column of the cell at the top left corner
+  unsigned zoom = 0; ///< Each dot shows a square of 2^zoom cells per side
+};
+
+/// Largest zoom of a viewport, a dot of 2^30 cells per side
+const unsigned MAX_ZOOM = 30;
+
+/**
+ * Smallest zoom showing a whole board on a number of dots.
+ *
+ * @param width size_t with the number of columns of the board.
+ * @param height size_t with the number of rows of the board.
+ * @param dot_columns size_t with the number of dots along a line.
+ * @param dot_rows size_t with the number of lines of dots.
+ */
+unsigned fit_zoom(size_t width, size_t height, size_t dot_columns,
+                  size_t dot_rows);
+
+/// Keys read by TerminalInput besides the characters
+enum Key { NO_KEY = -1, KEY_UP = 256, KEY_DOWN, KEY_LEFT, KEY_RIGHT };
+
+/**
+ * Moves or zooms a viewport by a key: the arrows or h, j, k and l pan by a
+ * quarter of the view, + and - zoom in and out around its centre.
+ *
+ * @param view Viewport passed by reference.
+ * @param key int read by TerminalInput.
+ * @param width size_t with the number of columns of the board.
+ * @param height size_t with the number of rows of the board.
+ * @param dot_columns size_t with the number of dots along a line.
+ * @param dot_rows size_t with the number of lines of dots.
+ * @return bool true if the viewport changed.
+ */
+bool steer_viewport(Viewport &view, int key, size_t width, size_t height,
+                    size_t dot_columns, size_t dot_rows);
+
+/**
+ * Populations of the square tiles of a board, from 8x8 cells and doubling
+ * their side level by level until a single tile covers the board.
+ *
+ * Building it reads every cell once, a byte wise popcount per word of a
+ * PackedBoard, and the levels above the first add up to a third of the
+ * tiles below them.
+ */
+class DensityMap {
+public:
+  /// Tiles of the first level are 2^TILE_ZOOM cells per side
+  static const unsigned TILE_ZOOM = 3;
+
+  /**
+   * Counts the living cells of every tile of a board.
+   *
+   * @param board Grid passed as const reference.
+   */
+  void build(const Board &board);
+  void build(const PackedBoard &board);
+
+  /**
+   * Living cells in a square of a level, none past the board.
+   *
+   * @param zoom unsigned with the side of the square as a power of 2, at
+   * least TILE_ZOOM.
+   * @param row size_t with the row of the square, a cell row >> zoom.
+   * @param column size_t with the column of the square, a cell column >>
+   * zoom.
+   */
+  std::uint32_t count(unsigned zoom, size_t row, size_t column) const;
+
+private:
+  /// Counts of the tiles of one side, row by row
+  struct Level {
+    size_t columns = 0, rows = 0;
+    std::vector<std::uint32_t> counts;
+  };
+
+  /// Adds up the first level into the levels above it
+  void summarise();
+
+  size_t tile_columns = 0, tile_rows = 0;
+  std::vector<std::uint8_t> tiles; ///< First level, at most 64 per tile
+  std::vector<Level> levels;       ///< Levels above the first one
+};
+
+/**
+ * Living cells in a square of a board, read from its map when the square is
+ * at least a tile and counted cell by cell otherwise.
+ *
+ * @param zoom unsigned with the side of the square as a power of 2.
+ * @param row size_t with the row of its top left cell, a multiple of the side.
+ * @param column size_t with the column of its top left cell, a multiple of
+ * the side.
+ */
+template <typename Grid>
+std::uint32_t living_cells(const Grid &board, const DensityMap &density,
+                           unsigned zoom, size_t row, size_t column) {
+  if (zoom >= DensityMap::TILE_ZOOM)
+    return density.count(zoom, row >> zoom, column >> zoom);
+  const size_t side = size_t(1) << zoom;
+  std::uint32_t living = 0;
+  for (size_t i = row; i < std::min(row + side, board.height()); ++i)
+    for (size_t j = column; j < std::min(column + side, board.width()); ++j)
+      living += board.get(i, j) == Cell::alive;
+  return living;
+}
+
+/**
+ * Draws a viewport of a board on the terminal, sized to the terminal.
+ *
+ * Like TerminalRenderer it keeps what is on the screen, and only rewrites
+ * the lines of glyphs that changed since the previous frame.
+ */
+class ViewportRenderer {
+public:
+  /**
+   * @param mode ViewMode with the glyphs drawn, braille or half_blocks.
+   * @param fd int with the file descriptor of the terminal.
+   */
+  explicit ViewportRenderer(ViewMode mode = ViewMode::braille,
+                            int fd = STDOUT_FILENO);
+
+  /**
+   * Number of dots the terminal shows above its status line, taking 80x24
+   * characters if it is not a terminal.
+   */
+  void dots(size_t &dot_columns, size_t &dot_rows) const;
+
+  /**
+   * Draws a frame: the part of the board under the viewport and a status
+   * line below it.
+   *
+   * @param board Grid passed as const reference.
+   * @param density const DensityMap built from the board.
+   * @param view const Viewport with the window drawn, its corner rounded
+   * down to a whole dot.
+   * @param status const std::string printed below the board.
+   */
+  template <typename Grid>
+  void render(const Grid &board, const DensityMap &density,
+              const Viewport &view, const std::string &status) {
+    PROFILE_SCOPE("render");
+    const size_t side = size_t(1) << view.zoom;
+    const size_t top = view.top & ~(side - 1);
+    const size_t left = view.left & ~(side - 1);
+    size_t columns, rows;
+    terminal_size(columns, rows);
+    // The glyphs past the board are left out rather than drawn blank.
+    columns = std::min(columns, glyphs(board.width(), left, side, dot_width));
+    rows = std::min(rows, glyphs(board.height(), top, side, dot_height));
+
+    frame.clear();
+    if (columns != shown_columns || lines.size() != rows) {
+      frame += "\x1b[H\x1b[2J";
+      lines.assign(rows, std::string());
+      shown_columns = columns;
+    }
+    for (size_t g = 0; g < rows; ++g) {
+      line.clear();
+      for (size_t c = 0; c < columns; ++c) {
+        std::uint32_t living[2][4];
+        for (size_t y = 0; y < dot_height; ++y)
+          for (size_t x = 0; x < dot_width; ++x)
+            living[x][y] =
+                living_cells(board, density, view.zoom,
+                             top + (g * dot_height + y) * side,
+                             left + (c * dot_width + x) * side);
+        append_glyph(living, view.zoom);
+      }
+      end_line();
+      if (line != lines[g]) {
+        move_cursor(g, 0);
+        frame += line;
+        lines[g].swap(line);
+      }
+    }
+
+    move_cursor(rows, 0);
+    frame += status + " | " + std::to_string(side) + "x" +
+             std::to_string(side) + " cells per dot from row " +
+             std::to_string(top) + ", column " + std::to_string(left);
+    frame += "\x1b[K\n";
+    flush();
+  }
+
+private:
+  /// Glyphs needed to show a board from a corner, with dots of a side
+  static size_t glyphs(size_t cells, size_t corner, size_t side,
+                       size_t dots_per_glyph);
+  /// Number of characters of the terminal, less the status line
+  void terminal_size(size_t &columns, size_t &rows) const;
+  /// Appends the glyph of the dots of a character to the line
+  void append_glyph(const std::uint32_t living[2][4], unsigned zoom);
+  /// Ends the line, resetting its colours
+  void end_line();
+  /// Appends the sequence moving the cursor to a 0-based line and column
+  void move_cursor(size_t line, size_t column);
+  /// Writes the frame buffer to the terminal
+  void flush();
+
+  ViewMode mode;
+  int fd;
+  size_t dot_width, dot_height; ///< Dots of a glyph
+  size_t shown_columns = 0;     ///< Glyphs of the lines on the screen
+  std::vector<std::string> lines; ///< Lines of glyphs on the screen
+  unsigned colours[2] = {0, 0};   ///< Colours of the line being built
+  std::string line;
+  std::string frame;
+};
+
+/**
+ * Keys typed on the terminal, read without waiting nor echoing them.
+ *
+ * While it exists the terminal is out of its line mode; it is restored when
+ * it is destroyed, or on SIGINT before the default handler runs.
+ */
+class TerminalInput {
+public:
+  /// Switches the standard input to raw keys, if it is a terminal
+  TerminalInput();
+  ~TerminalInput();
+
+  TerminalInput(const TerminalInput &) = delete;
+  TerminalInput &operator=(const TerminalInput &) = delete;
+
+  /// Next key typed, a character or a Key, or NO_KEY if there is none
+  int read_key();
+
+private:
+  bool raw = false;
+  std::string pending; ///< Bytes read and not returned yet
+};
+
+#endif // VIEWPORT_H